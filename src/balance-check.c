@@ -0,0 +1,179 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+/* Checks of the hash balancer, run by "make check": how evenly clients
+	spread over backends, and how few of them move when a backend is
+	added or removed, see balanceLookup(). */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "balance.h"
+
+enum { clientCount = 200000, maxBackends = 16 };
+
+static int failures;
+static char checkHost[] = "check";
+
+static void buildServer(ServerInfo *srv, int count, int removed,
+	int const *weights);
+static void freeServer(ServerInfo *srv);
+static int backendOf(ServerInfo const *srv, int client);
+static void check(int ok, char const *format, double value, double bound);
+
+int main(void)
+{
+	static int before[clientCount];
+	ServerInfo srv;
+
+	/* Ten backends of the same weight share clients evenly */
+	int counts[maxBackends] = { 0 };
+	buildServer(&srv, 10, -1, NULL);
+	for (int i = 0; i < clientCount; ++i) {
+		before[i] = backendOf(&srv, i);
+		++counts[before[i]];
+	}
+	freeServer(&srv);
+	int least = clientCount, most = 0;
+	for (int b = 0; b < 10; ++b) {
+		least = counts[b] < least ? counts[b] : least;
+		most = counts[b] > most ? counts[b] : most;
+	}
+	double mean = clientCount / 10.0;
+	check(most / mean <= 1.05, "busiest backend / mean: %.3f (at most %.3f)",
+		most / mean, 1.05);
+	check(least / mean >= 0.95, "idlest backend / mean: %.3f (at least %.3f)",
+		least / mean, 0.95);
+
+	/* Adding an eleventh backend moves about a eleventh of the clients,
+		all of them to the new backend */
+	int moved = 0, elsewhere = 0;
+	buildServer(&srv, 11, -1, NULL);
+	for (int i = 0; i < clientCount; ++i) {
+		int b = backendOf(&srv, i);
+		if (b != before[i]) {
+			++moved;
+			elsewhere += b != 10;
+		}
+	}
+	freeServer(&srv);
+	check((double)moved / clientCount <= 1.2 / 11,
+		"moved when adding a backend: %.4f (at most %.4f)",
+		(double)moved / clientCount, 1.2 / 11);
+	check((double)moved / clientCount >= 0.8 / 11,
+		"moved when adding a backend: %.4f (at least %.4f)",
+		(double)moved / clientCount, 0.8 / 11);
+	check((double)elsewhere / clientCount <= 0.01,
+		"moved to an old backend when adding one: %.4f (at most %.4f)",
+		(double)elsewhere / clientCount, 0.01);
+
+	/* Removing a backend moves its clients, and almost no other */
+	moved = elsewhere = 0;
+	buildServer(&srv, 10, 3, NULL);
+	for (int i = 0; i < clientCount; ++i) {
+		int b = backendOf(&srv, i);
+		if (before[i] == 3) {
+			++moved;
+		} else if (b != before[i]) {
+			++elsewhere;
+		}
+	}
+	freeServer(&srv);
+	check((double)elsewhere / clientCount <= 0.01,
+		"moved from a kept backend when removing one: %.4f (at most %.4f)",
+		(double)elsewhere / clientCount, 0.01);
+
+	/* Shares follow the weights */
+	int const weights[] = { 1, 2, 3, 4 };
+	memset(counts, 0, sizeof(counts));
+	buildServer(&srv, 4, -1, weights);
+	for (int i = 0; i < clientCount; ++i) {
+		++counts[backendOf(&srv, i)];
+	}
+	freeServer(&srv);
+	for (int b = 0; b < 4; ++b) {
+		double share = (double)counts[b] / clientCount;
+		double expected = weights[b] / 10.0;
+		check(share >= expected * 0.95 && share <= expected * 1.05,
+			"share of weight %.0f out of 10: %.4f", weights[b], share);
+	}
+
+	printf("%s\n", failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
+
+/* Backends are numbered through portNum, so that removing one does not
+	renumber the others */
+static void buildServer(ServerInfo *srv, int count, int removed,
+	int const *weights)
+{
+	memset(srv, 0, sizeof(*srv));
+	srv->fromHost = checkHost;
+	srv->balance = balanceHash;
+	srv->backends = (Backend *)calloc(count, sizeof(Backend));
+	srv->counters = (ServerCounters *)calloc(1, sizeof(ServerCounters));
+	BackendCounters *backendCounters =
+		(BackendCounters *)calloc(count, sizeof(BackendCounters));
+	if (!srv->backends || !srv->counters || !backendCounters) {
+		exit(1);
+	}
+	srv->counters->backends = backendCounters;
+	for (int i = 0; i < count; ++i) {
+		if (i == removed) {
+			continue;
+		}
+		Backend *backend = &srv->backends[srv->backendCount++];
+		backend->addr.s_addr = htonl(0x0a000001 + i);
+		backend->port = htons(80);
+		backend->host = checkHost;
+		backend->portNum = i;
+		backend->weight = weights ? weights[i] : 1;
+	}
+	if (balanceSchedule(srv) < 0) {
+		exit(1);
+	}
+	srv->balancer = balanceOpen(srv, 1);
+	if (!srv->balancer) {
+		exit(1);
+	}
+}
+
+static void freeServer(ServerInfo *srv)
+{
+	balanceClose(srv->balancer);
+	free(srv->schedule);
+	free(srv->lookup);
+	free(srv->counters->backends);
+	free(srv->counters);
+	free(srv->backends);
+}
+
+static int backendOf(ServerInfo const *srv, int client)
+{
+	struct in_addr addr;
+	addr.s_addr = htonl(0xc0000000u + (unsigned)client * 7919u);
+	int slot = balancePick(srv, addr);
+	balanceRelease(srv, slot);
+	return srv->backends[srv->schedule[slot]].portNum;
+}
+
+static void check(int ok, char const *format, double value, double bound)
+{
+	printf(ok ? "ok    " : "FAIL  ");
+	printf(format, value, bound);
+	printf("\n");
+	failures += !ok;
+}
@@ -0,0 +1,454 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "balance.h"
+
+struct _balancer
+{
+	/* Next position for round robin, and state of the random
+		generator for the power of two choices */
+	int next;
+	unsigned random;
+	/* For least connections, each position of the schedule is a unit
+		with connections of its own, so that weights need no division.
+		Units are linked in lists by their number of connections, and
+		least is the first list that is not empty. */
+	int *unitConnections, *unitNext, *unitPrev;
+	int *lists, listCount, least;
+};
+
+static void unitUnlink(Balancer *balancer, int unit);
+static void unitLink(Balancer *balancer, int unit, int connections);
+static unsigned randomNext(Balancer *balancer);
+static int balanceLookup(ServerInfo *srv);
+static unsigned hashMix(unsigned x);
+static int slotSkipped(Balancer *balancer, ServerInfo const *srv, int slot,
+	time_t now);
+static int slotUp(Balancer *balancer, ServerInfo const *srv, int slot,
+	time_t now);
+static void slotTake(ServerInfo const *srv, int slot);
+
+/* Interleave backends by weight, the way smooth weighted round robin
+	does: every turn, each backend earns its weight, and the richest
+	one is chosen and pays the total. */
+int balanceSchedule(ServerInfo *srv)
+{
+	int total = 0;
+	for (int i = 0; i < srv->backendCount; ++i) {
+		total += srv->backends[i].weight;
+	}
+	int *current = (int *)calloc(srv->backendCount, sizeof(int));
+	srv->schedule = (int *)malloc(sizeof(int) * total);
+	if (!current || !srv->schedule) {
+		free(current);
+		return -1;
+	}
+	for (int k = 0; k < total; ++k) {
+		int best = 0;
+		for (int i = 0; i < srv->backendCount; ++i) {
+			current[i] += srv->backends[i].weight;
+			if (current[i] > current[best]) {
+				best = i;
+			}
+		}
+		current[best] -= total;
+		srv->schedule[k] = best;
+	}
+	srv->scheduleLength = total;
+	free(current);
+	return srv->balance == balanceHash ? balanceLookup(srv) : 0;
+}
+
+/* Fill the lookup table the way Maglev does: each backend has its own
+	permutation of the table, from its address, and backends take turns
+	claiming the next entry of their permutation that is still free,
+	as many times as their weight. Every backend thus gets a share of
+	the table close to its weight, and a change of backends moves few
+	entries of the others. */
+static int balanceLookup(ServerInfo *srv)
+{
+	int size = RINETD_HASH_TABLE_SIZE;
+	int count = srv->backendCount;
+	srv->lookup = (int *)malloc(sizeof(int) * size);
+	unsigned *permutation = (unsigned *)malloc(sizeof(unsigned) * 3 * count);
+	int *slots = (int *)malloc(sizeof(int) * count);
+	if (!srv->lookup || !permutation || !slots) {
+		free(permutation);
+		free(slots);
+		return -1;
+	}
+	unsigned *offset = permutation, *skip = offset + count;
+	unsigned *next = skip + count;
+	for (int i = 0; i < count; ++i) {
+		Backend const *backend = &srv->backends[i];
+		unsigned key = hashMix(ntohl(backend->addr.s_addr))
+			+ ntohs(backend->port);
+		offset[i] = hashMix(key) % (unsigned)size;
+		skip[i] = hashMix(key ^ 0x5bd1e995u) % (unsigned)(size - 1) + 1;
+		next[i] = 0;
+	}
+	/* Any schedule position of a backend will do */
+	for (int k = srv->scheduleLength - 1; k >= 0; --k) {
+		slots[srv->schedule[k]] = k;
+	}
+	memset(srv->lookup, -1, sizeof(int) * size);
+	for (int filled = 0; filled < size; ) {
+		for (int i = 0; i < count && filled < size; ++i) {
+			for (int w = 0; w < srv->backends[i].weight
+					&& filled < size; ++w) {
+				unsigned entry;
+				do {
+					entry = (unsigned)((offset[i] + (unsigned long long)
+						next[i]++ * skip[i]) % (unsigned)size);
+				} while (srv->lookup[entry] >= 0);
+				srv->lookup[entry] = slots[i];
+				++filled;
+			}
+		}
+	}
+	free(slots);
+	free(permutation);
+	return 0;
+}
+
+Balancer *balanceOpen(ServerInfo const *srv, unsigned seed)
+{
+	Balancer *balancer = (Balancer *)calloc(1, sizeof(Balancer));
+	if (!balancer) {
+		return NULL;
+	}
+	/* Workers start at different places, so that they do not all
+		send their first connections to the same backend */
+	int length = srv->scheduleLength;
+	balancer->next = (int)(seed % (unsigned)length);
+	balancer->random = seed | 1;
+	if (srv->balance == balanceLeastConnections) {
+		balancer->unitConnections = (int *)calloc(length * 3, sizeof(int));
+		balancer->lists = (int *)malloc(sizeof(int) * 16);
+		if (!balancer->unitConnections || !balancer->lists) {
+			balanceClose(balancer);
+			return NULL;
+		}
+		balancer->unitNext = balancer->unitConnections + length;
+		balancer->unitPrev = balancer->unitNext + length;
+		balancer->listCount = 16;
+		memset(balancer->lists, -1, sizeof(int) * 16);
+		for (int k = length - 1; k >= 0; --k) {
+			unitLink(balancer, (k + balancer->next) % length, 0);
+		}
+	}
+	return balancer;
+}
+
+void balanceClose(Balancer *balancer)
+{
+	if (balancer) {
+		free(balancer->unitConnections);
+		free(balancer->lists);
+		free(balancer);
+	}
+}
+
+int balancePick(ServerInfo const *srv, struct in_addr client)
+{
+	Balancer *balancer = srv->balancer;
+	BackendCounters *counters = srv->counters->backends;
+	int slot;
+	time_t now = time(NULL);
+	/* Backends found down by health checks, or ejected, are skipped,
+		which only costs more than constant time while some are. When
+		all of them are, the usual choice stands. */
+	if (srv->balance == balanceHash) {
+		/* Clients of a backend that is down spread over the next
+			entries, so that those of the others stay where they are */
+		unsigned entry = hashMix(ntohl(client.s_addr))
+			% (unsigned)RINETD_HASH_TABLE_SIZE;
+		slot = srv->lookup[entry];
+		for (int i = 1;
+				i < 32 && slotSkipped(balancer, srv, slot, now); ++i) {
+			slot = srv->lookup[(entry + i)
+				% (unsigned)RINETD_HASH_TABLE_SIZE];
+		}
+		slot = slotUp(balancer, srv, slot, now);
+	} else if (srv->balance == balanceLeastConnections) {
+		slot = balancer->lists[balancer->least];
+		for (int c = balancer->least;
+				c < balancer->listCount
+				&& slotSkipped(balancer, srv, slot, now); ++c) {
+			for (int unit = balancer->lists[c]; unit >= 0;
+					unit = balancer->unitNext[unit]) {
+				if (!slotSkipped(balancer, srv, unit, now)) {
+					slot = unit;
+					break;
+				}
+			}
+		}
+	} else if (srv->balance == balancePowerOfTwo) {
+		/* Drawing from the schedule follows the weights, and the
+			second draw is never the same position as the first.
+			Backends not tried for a while have their average
+			forgotten, and go first, so that those avoided after
+			failures get another chance. */
+		unsigned length = (unsigned)srv->scheduleLength;
+		int first = (int)(randomNext(balancer) % length);
+		int second = first;
+		if (length > 1) {
+			second = (int)((first + 1
+				+ randomNext(balancer) % (length - 1)) % length);
+		}
+		first = slotUp(balancer, srv, first, now);
+		second = slotUp(balancer, srv, second, now);
+		BackendCounters *a = &counters[srv->schedule[first]];
+		BackendCounters *b = &counters[srv->schedule[second]];
+		if (now - a->connectTimeUpdated > RINETD_BALANCE_FORGET_TIME) {
+			a->connectTime = 0;
+		}
+		if (now - b->connectTimeUpdated > RINETD_BALANCE_FORGET_TIME) {
+			b->connectTime = 0;
+		}
+		unsigned long long costA = (unsigned long long)a->connectTime
+			* (a->connections + 1);
+		unsigned long long costB = (unsigned long long)b->connectTime
+			* (b->connections + 1);
+		slot = costA < costB || (costA == costB
+			&& a->connections <= b->connections) ? first : second;
+	} else {
+		slot = slotUp(balancer, srv, balancer->next, now);
+		balancer->next = slot + 1 < srv->scheduleLength ? slot + 1 : 0;
+	}
+	slotTake(srv, slot);
+	return slot;
+}
+
+int balanceRetry(ServerInfo const *srv, int slot, struct in_addr client)
+{
+	int failed = srv->schedule[slot];
+	balanceRelease(srv, slot);
+	slot = balancePick(srv, client);
+	if (srv->schedule[slot] != failed) {
+		return slot;
+	}
+	/* The usual choice may well be the same backend again, as with
+		the hash balancer, so take the next one that is up instead */
+	time_t now = time(NULL);
+	for (int i = 1; i < srv->scheduleLength; ++i) {
+		int next = (slot + i) % srv->scheduleLength;
+		if (srv->schedule[next] != failed
+			&& !slotSkipped(srv->balancer, srv, next, now)) {
+			balanceRelease(srv, slot);
+			slotTake(srv, next);
+			return next;
+		}
+	}
+	return slot;
+}
+
+void balanceRelease(ServerInfo const *srv, int slot)
+{
+	Balancer *balancer = srv->balancer;
+	--srv->counters->backends[srv->schedule[slot]].connections;
+	if (srv->balance == balanceLeastConnections) {
+		int connections = balancer->unitConnections[slot] - 1;
+		unitUnlink(balancer, slot);
+		unitLink(balancer, slot, connections);
+		if (connections < balancer->least) {
+			balancer->least = connections;
+		}
+	}
+}
+
+void balanceConnected(ServerInfo const *srv, int slot, long long elapsed,
+	int failed)
+{
+	BackendCounters *counters =
+		&srv->counters->backends[srv->schedule[slot]];
+	if (failed) {
+		++counters->connectFailures;
+		if (elapsed < RINETD_FAILED_CONNECT_TIME) {
+			elapsed = RINETD_FAILED_CONNECT_TIME;
+		}
+	}
+	counters->connectTimeUpdated = time(NULL);
+	if (counters->connectTime == 0) {
+		counters->connectTime = elapsed > 0 ? elapsed : 1;
+	} else {
+		counters->connectTime += (elapsed - counters->connectTime) / 8;
+	}
+}
+
+void balanceFailed(ServerInfo const *srv, int slot)
+{
+	if (!srv->ejectFailures) {
+		return;
+	}
+	int b = srv->schedule[slot];
+	Backend *backend = &srv->backends[b];
+	time_t now = time(NULL);
+	/* Connections that were already under way when the backend was
+		ejected tell nothing new */
+	if (now < __atomic_load_n(&backend->ejectedUntil, __ATOMIC_RELAXED)) {
+		return;
+	}
+	if (__atomic_add_fetch(&backend->failures, 1, __ATOMIC_RELAXED)
+			!= srv->ejectFailures) {
+		return;
+	}
+	int ejections = __atomic_add_fetch(&backend->ejections, 1,
+		__ATOMIC_RELAXED);
+	int duration = srv->ejectTime << (ejections < 16 ? ejections - 1 : 15);
+	if (duration > RINETD_MAX_EJECT_TIME) {
+		duration = RINETD_MAX_EJECT_TIME;
+	}
+	__atomic_store_n(&backend->ejectedUntil, now + duration,
+		__ATOMIC_RELAXED);
+	__atomic_store_n(&backend->failures, 0, __ATOMIC_RELAXED);
+	++srv->counters->backends[b].ejections;
+	syslog(LOG_INFO, "backend %s:%d of %s:%d ejected for %d s\n",
+		backend->host, backend->portNum, srv->fromHost, srv->fromPort,
+		duration);
+}
+
+void balanceSucceeded(ServerInfo const *srv, int slot)
+{
+	if (!srv->ejectFailures) {
+		return;
+	}
+	Backend *backend = &srv->backends[srv->schedule[slot]];
+	if (__atomic_load_n(&backend->failures, __ATOMIC_RELAXED)) {
+		__atomic_store_n(&backend->failures, 0, __ATOMIC_RELAXED);
+	}
+	/* Ejections only count as in a row until the backend has been
+		fully readmitted */
+	if (__atomic_load_n(&backend->ejections, __ATOMIC_RELAXED)
+			&& time(NULL) >= __atomic_load_n(&backend->ejectedUntil,
+				__ATOMIC_RELAXED) + srv->ejectTime) {
+		__atomic_store_n(&backend->ejections, 0, __ATOMIC_RELAXED);
+	}
+}
+
+static void unitUnlink(Balancer *balancer, int unit)
+{
+	int next = balancer->unitNext[unit];
+	int prev = balancer->unitPrev[unit];
+	if (prev >= 0) {
+		balancer->unitNext[prev] = next;
+	} else {
+		balancer->lists[balancer->unitConnections[unit]] = next;
+	}
+	if (next >= 0) {
+		balancer->unitPrev[next] = prev;
+	}
+}
+
+static void unitLink(Balancer *balancer, int unit, int connections)
+{
+	if (connections >= balancer->listCount) {
+		int count = balancer->listCount * 2;
+		int *lists = (int *)realloc(balancer->lists, sizeof(int) * count);
+		if (!lists) {
+			exit(1);
+		}
+		memset(lists + balancer->listCount, -1,
+			sizeof(int) * (count - balancer->listCount));
+		balancer->lists = lists;
+		balancer->listCount = count;
+	}
+	int next = balancer->lists[connections];
+	balancer->unitConnections[unit] = connections;
+	balancer->unitNext[unit] = next;
+	balancer->unitPrev[unit] = -1;
+	if (next >= 0) {
+		balancer->unitPrev[next] = unit;
+	}
+	balancer->lists[connections] = unit;
+}
+
+/* Whether the backend at the given position is down, or ejected. Once
+	an ejection is over, the backend gets a share of its connections
+	that grows over ejectTime seconds, so that it is not flooded at
+	once if it is still unwell. */
+static int slotSkipped(Balancer *balancer, ServerInfo const *srv, int slot,
+	time_t now)
+{
+	Backend *backend = &srv->backends[srv->schedule[slot]];
+	if (__atomic_load_n(&backend->down, __ATOMIC_RELAXED)) {
+		return 1;
+	}
+	if (!srv->ejectFailures) {
+		return 0;
+	}
+	time_t until = __atomic_load_n(&backend->ejectedUntil, __ATOMIC_RELAXED);
+	if (now < until) {
+		return 1;
+	}
+	return now - until < srv->ejectTime
+		&& (time_t)(randomNext(balancer) % (unsigned)(srv->ejectTime + 1))
+			> now - until;
+}
+
+/* The first position from the given one whose backend is up, or the
+	given one if none is */
+static int slotUp(Balancer *balancer, ServerInfo const *srv, int slot,
+	time_t now)
+{
+	for (int i = 0; i < srv->scheduleLength; ++i) {
+		int next = (slot + i) % srv->scheduleLength;
+		if (!slotSkipped(balancer, srv, next, now)) {
+			return next;
+		}
+	}
+	return slot;
+}
+
+/* Count a new connection at the given position */
+static void slotTake(ServerInfo const *srv, int slot)
+{
+	Balancer *balancer = srv->balancer;
+	if (srv->balance == balanceLeastConnections) {
+		int connections = balancer->unitConnections[slot];
+		unitUnlink(balancer, slot);
+		unitLink(balancer, slot, connections + 1);
+		if (balancer->lists[balancer->least] < 0) {
+			++balancer->least;
+		}
+	}
+	++srv->counters->backends[srv->schedule[slot]].connections;
+	++srv->counters->backends[srv->schedule[slot]].connects;
+}
+
+static unsigned hashMix(unsigned x)
+{
+	/* The final mix of MurmurHash3 */
+	x ^= x >> 16;
+	x *= 0x85ebca6bu;
+	x ^= x >> 13;
+	x *= 0xc2b2ae35u;
+	x ^= x >> 16;
+	return x;
+}
+
+static unsigned randomNext(Balancer *balancer)
+{
+	/* Xorshift, good enough to spread connections */
+	unsigned x = balancer->random;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return balancer->random = x;
+}
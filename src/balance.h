@@ -0,0 +1,41 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Backend selection. The configuration gives each server a schedule
+	once parsed, then each worker keeps a balancer of its own for each
+	of its servers, so nothing here needs locking. */
+
+int balanceSchedule(ServerInfo *srv);
+
+Balancer *balanceOpen(ServerInfo const *srv, unsigned seed);
+void balanceClose(Balancer *balancer);
+
+/* Both return and take a position in the schedule of the server, which
+	tells the backend, in constant time whatever the algorithm. Only
+	the hash balancer looks at the client address. */
+int balancePick(ServerInfo const *srv, struct in_addr client);
+void balanceRelease(ServerInfo const *srv, int slot);
+
+/* Release the given position and pick another one, of a different
+	backend if any is up, for a connection to retry */
+int balanceRetry(ServerInfo const *srv, int slot, struct in_addr client);
+
+/* Record the time it took to connect, for the moving average used
+	by the power of two choices */
+void balanceConnected(ServerInfo const *srv, int slot, long long elapsed,
+	int failed);
+
+/* Passive outlier detection. A connection fails when the local server
+	could not be reached, or reset or closed it within
+	RINETD_EARLY_CLOSE_TIME of connecting without sending anything, and
+	succeeds once it sends something. Enough failures in a row eject
+	the backend for a time that doubles with each ejection in a row. */
+void balanceFailed(ServerInfo const *srv, int slot);
+void balanceSucceeded(ServerInfo const *srv, int slot);
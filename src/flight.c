@@ -0,0 +1,94 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "log.h"
+#include "flight.h"
+
+static char const *const flightNames[] = {
+	"accept",
+	"connect",
+	"connected",
+	"read",
+	"write",
+	"close",
+};
+
+static int flightFormat(char *line, int size, FlightEvent const *entry);
+
+/* Log the events of a connection on a single line, oldest first */
+void flightDump(ConnectionInfo const *cnx, int worker, char const *reason)
+{
+	/* Its segment could not get events, see addFlights() */
+	if (!cnx->flight) {
+		return;
+	}
+	char line[2048];
+	ServerInfo const *srv = cnx->server;
+	Backend const *backend = srv && cnx->slot >= 0
+		? &srv->backends[srv->schedule[cnx->slot]] : NULL;
+	int length = snprintf(line, sizeof(line),
+		"connection %d of worker %d from %s to %s:%d, %s, %u events:",
+		cnx->index, worker, inet_ntoa(cnx->remoteAddress.sin_addr),
+		backend ? backend->host : "?", backend ? backend->portNum : 0,
+		reason, cnx->flightCount);
+
+	unsigned count = cnx->flightCount;
+	for (unsigned i = 0; i < count && i < flightFirstEvents; ++i) {
+		length += flightFormat(line + length, sizeof(line) - length,
+			&cnx->flight[i]);
+	}
+	if (count > flightEvents) {
+		length += snprintf(line + length, sizeof(line) - length,
+			" ... %u more ...", count - flightEvents);
+	}
+	/* Then the latest events, from the oldest of them */
+	unsigned ring = flightEvents - flightFirstEvents;
+	unsigned first = count > flightEvents ? count - ring : flightFirstEvents;
+	for (unsigned i = first; i < count; ++i) {
+		unsigned n = flightFirstEvents + (i - flightFirstEvents) % ring;
+		length += flightFormat(line + length, sizeof(line) - length,
+			&cnx->flight[n]);
+	}
+	syslog(LOG_INFO, "%s\n", line);
+}
+
+static int flightFormat(char *line, int size, FlightEvent const *entry)
+{
+	if (size <= 1) {
+		return 0;
+	}
+	int length = snprintf(line, size, " +%lld.%03lld %s",
+		entry->time / 1000000, entry->time / 1000 % 1000,
+		flightNames[entry->event]);
+	if (entry->event >= flightRead) {
+		length += snprintf(line + length, size - length, " %s",
+			entry->local ? "local" : "remote");
+	}
+	if (entry->event == flightRead || entry->event == flightWrite) {
+		if (entry->value == -WSAEWOULDBLOCK) {
+			length += snprintf(line + length, size - length, " blocked");
+		} else {
+			length += snprintf(line + length, size - length, " %d",
+				entry->value);
+		}
+	} else if (entry->event == flightConnectDone && entry->value) {
+		length += snprintf(line + length, size - length, " error %d",
+			entry->value);
+	}
+	return length < size ? length : size - 1;
+}
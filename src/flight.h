@@ -0,0 +1,42 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Flight recorder. When enabled, each connection keeps its first and
+	latest events in a small array of its own, which is logged if the
+	connection turns out slow or long, or on request. Arrays are
+	allocated with the connection table while the recorder is enabled,
+	never when accepting a connection. Nothing is recorded while it is
+	disabled. It is enabled by a latency threshold, a duration threshold,
+	or both. */
+
+static inline int flightEnabled(void)
+{
+	return flightLatency || flightDuration;
+}
+
+static inline void flightRecord(ConnectionInfo *cnx, int event, int local,
+	int value)
+{
+	if (!flightEnabled() || !cnx->flight) {
+		return;
+	}
+	unsigned n = cnx->flightCount++;
+	if (n >= flightFirstEvents) {
+		n = flightFirstEvents
+			+ (n - flightFirstEvents) % (flightEvents - flightFirstEvents);
+	}
+	FlightEvent *entry = &cnx->flight[n];
+	entry->time = logClock() - cnx->openedTime;
+	entry->value = value;
+	entry->event = (unsigned char)event;
+	entry->local = (unsigned char)local;
+}
+
+void flightDump(ConnectionInfo const *cnx, int worker, char const *reason);
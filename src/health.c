@@ -0,0 +1,237 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "timer.h"
+#include "watchdog.h"
+#include "health.h"
+
+typedef struct _probe Probe;
+struct _probe
+{
+	ServerInfo const *srv;
+	Backend *backend;
+	/* Socket of the check in flight, if any, and when it started, in
+		microseconds, see watchdogClock() */
+	SOCKET fd;
+	long long started;
+	time_t next;
+	int successes, failures;
+};
+
+static Probe *probes;
+static int probeCount;
+static Timer healthTimer;
+static void (*probeWatch)(SOCKET fd, int probe, int writable);
+static void (*probeClose)(SOCKET fd);
+
+static void healthPass(Timer *timer);
+static void probeStart(Probe *probe);
+static int probeResult(Probe *probe);
+static void probeDone(Probe *probe, int success);
+
+void healthOpen(void (*watch)(SOCKET fd, int probe, int writable),
+	void (*close)(SOCKET fd))
+{
+	probeWatch = watch;
+	probeClose = close;
+	probeCount = 0;
+	for (int i = 0; i < allServersCount; ++i) {
+		if (allServers[i].checkInterval) {
+			probeCount += allServers[i].backendCount;
+		}
+	}
+	if (!probeCount) {
+		return;
+	}
+	probes = (Probe *)calloc(probeCount, sizeof(Probe));
+	if (!probes) {
+		exit(1);
+	}
+	/* Spread the first checks over the interval */
+	time_t now = time(NULL);
+	Probe *probe = probes;
+	for (int i = 0; i < allServersCount; ++i) {
+		ServerInfo const *srv = &allServers[i];
+		for (int b = 0; srv->checkInterval && b < srv->backendCount; ++b) {
+			probe->srv = srv;
+			probe->backend = &srv->backends[b];
+			probe->fd = INVALID_SOCKET;
+			probe->next = now + 1 + b % srv->checkInterval;
+			++probe;
+		}
+	}
+	timerInit(&healthTimer, healthPass, NULL);
+	timerSet(&healthTimer, now + 1);
+}
+
+void healthClose(void)
+{
+	timerCancel(&healthTimer);
+	for (int i = 0; i < probeCount; ++i) {
+		if (probes[i].fd != INVALID_SOCKET) {
+			probeClose(probes[i].fd);
+		}
+	}
+	free(probes);
+	probes = NULL;
+	probeCount = 0;
+}
+
+int healthCount(void)
+{
+	return probeCount;
+}
+
+SOCKET healthSocket(int probe, int *writable)
+{
+	if (probe >= probeCount) {
+		return INVALID_SOCKET;
+	}
+	*writable = probes[probe].srv->toProto == protoTcp;
+	return probes[probe].fd;
+}
+
+int healthReady(int probe)
+{
+	if (probe >= probeCount || probes[probe].fd == INVALID_SOCKET) {
+		return 0;
+	}
+	int result = probeResult(&probes[probe]);
+	if (result != 0) {
+		probeDone(&probes[probe], result > 0);
+	}
+	return result == 0;
+}
+
+static void healthPass(Timer *timer)
+{
+	time_t now = time(NULL);
+	long long clock = watchdogClock();
+	for (int i = 0; i < probeCount; ++i) {
+		Probe *probe = &probes[i];
+		/* Checks get a full interval to answer. Answers themselves
+			are reported by the event loop, see healthReady(). */
+		if (probe->fd != INVALID_SOCKET && clock - probe->started
+				>= probe->srv->checkInterval * 1000000LL) {
+			probeDone(probe, 0);
+		}
+		if (probe->fd == INVALID_SOCKET && now >= probe->next) {
+			probe->next = now + probe->srv->checkInterval;
+			probeStart(probe);
+		}
+	}
+	timerSet(timer, now + 1);
+}
+
+static void probeStart(Probe *probe)
+{
+	ServerInfo const *srv = probe->srv;
+	SOCKET fd = srv->toProto == protoTcp
+		? socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)
+		: socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
+	if (fd == INVALID_SOCKET) {
+		syslog(LOG_ERR, "socket(): %m\n");
+		return;
+	}
+	setSocketDefaults(fd);
+
+	struct sockaddr_in saddr;
+	memset(&saddr, 0, sizeof(struct sockaddr_in));
+	saddr.sin_family = AF_INET;
+	memcpy(&saddr.sin_addr, &srv->sourceAddr, sizeof(struct in_addr));
+	saddr.sin_port = 0;
+	bind(fd, (struct sockaddr *)&saddr, sizeof(saddr));
+
+	memset(&saddr, 0, sizeof(struct sockaddr_in));
+	saddr.sin_family = AF_INET;
+	memcpy(&saddr.sin_addr, &probe->backend->addr, sizeof(struct in_addr));
+	saddr.sin_port = probe->backend->port;
+	probe->fd = fd;
+	probe->started = watchdogClock();
+	if (connect(fd, (struct sockaddr *)&saddr,
+			sizeof(struct sockaddr_in)) == SOCKET_ERROR
+		&& GetLastError() != WSAEINPROGRESS
+		&& GetLastError() != WSAEWOULDBLOCK) {
+		probeDone(probe, 0);
+		return;
+	}
+	/* Connected UDP sockets get refusals reported by the next receive */
+	if (srv->toProto == protoUdp) {
+		char const *payload = srv->checkSend ? srv->checkSend : "";
+		if (send(fd, payload, (int)strlen(payload), 0) < 0) {
+			probeDone(probe, 0);
+			return;
+		}
+	}
+	probeWatch(fd, (int)(probe - probes), srv->toProto == protoTcp);
+}
+
+/* Returns 1 once the check succeeded, -1 if it failed, 0 if it is
+	still in flight */
+static int probeResult(Probe *probe)
+{
+	ServerInfo const *srv = probe->srv;
+	if (srv->toProto == protoUdp) {
+		char reply[512];
+		int got = recv(probe->fd, reply, sizeof(reply), 0);
+		if (got < 0) {
+			return GetLastError() == WSAEWOULDBLOCK
+				|| GetLastError() == WSAEAGAIN ? 0 : -1;
+		}
+		size_t length = srv->checkExpect ? strlen(srv->checkExpect) : 0;
+		return length == 0 || ((size_t)got >= length
+			&& memcmp(reply, srv->checkExpect, length) == 0) ? 1 : -1;
+	}
+	struct sockaddr_in addr;
+	SOCKLEN_T addrlen = sizeof(addr);
+	if (getpeername(probe->fd, (struct sockaddr *)&addr,
+			&addrlen) != SOCKET_ERROR) {
+		return 1;
+	}
+	int error = 0;
+	SOCKLEN_T length = sizeof(error);
+	getsockopt(probe->fd, SOL_SOCKET, SO_ERROR, (char *)&error, &length);
+	return error ? -1 : 0;
+}
+
+static void probeDone(Probe *probe, int success)
+{
+	probeClose(probe->fd);
+	probe->fd = INVALID_SOCKET;
+	ServerInfo const *srv = probe->srv;
+	Backend *backend = probe->backend;
+	int down = __atomic_load_n(&backend->down, __ATOMIC_RELAXED);
+	if (success) {
+		probe->failures = 0;
+		if (++probe->successes >= srv->checkRise && down) {
+			__atomic_store_n(&backend->down, 0, __ATOMIC_RELAXED);
+			syslog(LOG_INFO, "backend %s:%d of %s:%d is up\n",
+				backend->host, backend->portNum,
+				srv->fromHost, srv->fromPort);
+		}
+	} else {
+		probe->successes = 0;
+		if (++probe->failures >= srv->checkFall && !down) {
+			__atomic_store_n(&backend->down, 1, __ATOMIC_RELAXED);
+			syslog(LOG_INFO, "backend %s:%d of %s:%d is down\n",
+				backend->host, backend->portNum,
+				srv->fromHost, srv->fromPort);
+		}
+	}
+}
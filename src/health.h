@@ -0,0 +1,31 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Active health checks. The first worker connects to each backend of
+	the rules that ask for it, or sends it a datagram, from a timer of
+	its event loop, which then watches the probe sockets along with its
+	own. Nothing ever waits for a probe: the result is read once the
+	socket is ready, and each tick fails the probes in flight for a
+	whole interval, then starts the ones due. Backends are marked down,
+	which every worker's balancer skips, and up again after enough
+	checks in a row. */
+
+/* The event loop provides how to watch a probe socket, until writable
+	for TCP or readable for UDP, and how to close one it may watch */
+void healthOpen(void (*watch)(SOCKET fd, int probe, int writable),
+	void (*close)(SOCKET fd));
+void healthClose(void);
+
+/* Probe sockets, INVALID_SOCKET for probes not in flight, and what to
+	call once one is ready. healthReady() returns whether the probe is
+	still in flight, for engines that watch only once. */
+int healthCount(void);
+SOCKET healthSocket(int probe, int *writable);
+int healthReady(int probe);
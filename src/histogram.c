@@ -0,0 +1,53 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "net.h"
+#include "types.h"
+#include "histogram.h"
+
+/* Workers keep recording while this runs, so the sum may be a few
+	samples off, which does not matter for quantiles. */
+void histogramMerge(Histogram *total, Histogram const *histogram)
+{
+	total->count += histogram->count;
+	total->sum += histogram->sum;
+	for (int i = 0; i < histogramBuckets; ++i) {
+		total->buckets[i] += histogram->buckets[i];
+	}
+}
+
+/* The value below which the given fraction of samples lie, taken as
+	the middle of its bucket. Returns 0 if there are no samples. */
+long long histogramQuantile(Histogram const *histogram, double quantile)
+{
+	unsigned long long count = 0;
+	for (int i = 0; i < histogramBuckets; ++i) {
+		count += histogram->buckets[i];
+	}
+	unsigned long long rank = (unsigned long long)(quantile * count + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	}
+	unsigned long long seen = 0;
+	for (int i = 0; i < histogramBuckets; ++i) {
+		seen += histogram->buckets[i];
+		if (seen >= rank) {
+			if (i < 16) {
+				return i;
+			}
+			int shift = i / 16 - 1;
+			long long low = (long long)(16 + i % 16) << shift;
+			return low + (1ll << shift) / 2;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,34 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Latency histograms. Values below 16 have a bucket each, and every
+	power of two above is split into 16 buckets, so a value is known
+	within 1/16th of itself whatever its magnitude. Recording is a few
+	shifts and increments, and merging the histograms of all workers
+	is a sum of arrays. */
+
+static inline void histogramRecord(Histogram *histogram, long long value)
+{
+	unsigned long long v = value < 0 ? 0 : (unsigned long long)value;
+	if (v >= 1ull << 36) {
+		v = (1ull << 36) - 1;
+	}
+	int index = (int)v;
+	if (v >= 16) {
+		int magnitude = 63 - __builtin_clzll(v);
+		index = (magnitude - 3) * 16 + (int)((v >> (magnitude - 4)) & 15);
+	}
+	++histogram->buckets[index];
+	++histogram->count;
+	histogram->sum += v;
+}
+
+void histogramMerge(Histogram *total, Histogram const *histogram);
+long long histogramQuantile(Histogram const *histogram, double quantile);
@@ -0,0 +1,459 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#if HAVE_SYS_TIME_H
+#	include <sys/time.h>
+#endif
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "log.h"
+
+static char const *logMessages[] = {
+	"unknown-error",
+	"done-local-closed",
+	"done-remote-closed",
+	"accept-failed -",
+	"local-socket-failed -",
+	"local-bind-failed -",
+	"local-connect-failed -",
+	"opened",
+	"allowed",
+	"not-allowed",
+	"denied",
+};
+
+/* Each thread that logs has its own ring, with a single producer and
+	a single consumer. Only the producer moves tail, and only the
+	consumer moves head. */
+typedef struct _log_ring LogRing;
+struct _log_ring
+{
+	LogRecord *records;
+	unsigned head, tail;
+	unsigned long long dropped;
+	LogRing *next;
+};
+
+static LogRing *logRings = NULL;
+static THREAD_LOCAL LogRing *logRing = NULL;
+
+/* Formatted records waiting to be written at once */
+static char logBuffer[65536];
+static int logBufferLength = 0;
+static unsigned long long logDroppedReported = 0;
+
+/* The time of the last record, formatted */
+static time_t logStampTime = -1;
+static char logStamp[64];
+static int logStampZone;
+
+#if HAVE_WORKERS
+/* Held by whoever drains the rings, so that the configuration and
+	the log file can be changed while holding it */
+static pthread_mutex_t logLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t logCond = PTHREAD_COND_INITIALIZER;
+static int logSleeping = 0;
+static int logThreaded = 0;
+
+static void *logWriter(void *arg);
+#endif
+
+static LogRing *logAddRing(void);
+static int logDrain(void);
+static void logFormatRecord(LogRecord const *record);
+static int logFormatText(char *line, int size,
+	LogRecord const *record, int result, char const *addressText,
+	char const *fromHost, int fromPort, char const *toHost, int toPort);
+static int logFormatBinaryRecord(char *line, int size,
+	LogRecord const *record, int result,
+	char const *fromHost, int fromPort, char const *toHost, int toPort);
+static void logWrite(void);
+static struct tm *get_gmtoff(int *tz, struct tm *t, time_t tt);
+
+/* Current time in microseconds since the epoch */
+long long logClock(void)
+{
+#if HAVE_GETTIMEOFDAY
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (long long)tv.tv_sec * 1000000 + tv.tv_usec;
+#else
+	return (long long)time(NULL) * 1000000;
+#endif
+}
+
+void logStart(void)
+{
+#if HAVE_WORKERS
+	pthread_t thread;
+	sigset_t mask, oldmask;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+	int ret = pthread_create(&thread, NULL, logWriter, NULL);
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+	if (ret != 0) {
+		errno = ret;
+		syslog(LOG_ERR, "could not start the log writer (%m), "
+			"logging from the event loop\n");
+		return;
+	}
+	pthread_detach(thread);
+	logThreaded = 1;
+#endif
+}
+
+void logPush(LogRecord const *record)
+{
+	LogRing *ring = logRing ? logRing : logAddRing();
+	if (!ring) {
+		return;
+	}
+	unsigned tail = ring->tail;
+	if (tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)
+		== (unsigned)RINETD_LOG_RING_SIZE) {
+		/* Never wait for the writer */
+		__atomic_store_n(&ring->dropped, ring->dropped + 1,
+			__ATOMIC_RELAXED);
+		return;
+	}
+	ring->records[tail % RINETD_LOG_RING_SIZE] = *record;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_SEQ_CST);
+#if HAVE_WORKERS
+	/* A wakeup is lost if the writer is just about to wait, in which
+		case it wakes up on its own within a second. */
+	if (__atomic_load_n(&logSleeping, __ATOMIC_SEQ_CST)) {
+		pthread_cond_signal(&logCond);
+	}
+#endif
+}
+
+/* Write pending records, unless the writer thread does it */
+void logPass(void)
+{
+#if HAVE_WORKERS
+	if (logThreaded) {
+		return;
+	}
+#endif
+	logDrain();
+}
+
+/* Write all pending records, and keep the writer away until
+	logResume() is called. This takes a lock, so never call it from
+	a signal handler. */
+void logPause(void)
+{
+#if HAVE_WORKERS
+	pthread_mutex_lock(&logLock);
+#endif
+	logDrain();
+}
+
+void logResume(void)
+{
+#if HAVE_WORKERS
+	pthread_mutex_unlock(&logLock);
+#endif
+}
+
+unsigned long long logDroppedCount(void)
+{
+	unsigned long long dropped = 0;
+	LogRing *ring = __atomic_load_n(&logRings, __ATOMIC_ACQUIRE);
+	for (; ring; ring = ring->next) {
+		dropped += __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+	}
+	return dropped;
+}
+
+#if HAVE_WORKERS
+static void *logWriter(void *arg)
+{
+	(void)arg;
+	pthread_mutex_lock(&logLock);
+	while (1) {
+		__atomic_store_n(&logSleeping, 1, __ATOMIC_SEQ_CST);
+		if (!logDrain()) {
+			struct timespec deadline;
+			clock_gettime(CLOCK_REALTIME, &deadline);
+			++deadline.tv_sec;
+			pthread_cond_timedwait(&logCond, &logLock, &deadline);
+		}
+		__atomic_store_n(&logSleeping, 0, __ATOMIC_SEQ_CST);
+	}
+	return NULL;
+}
+#endif
+
+static LogRing *logAddRing(void)
+{
+	LogRing *ring = (LogRing *)calloc(1, sizeof(LogRing));
+	if (ring) {
+		ring->records = (LogRecord *)
+			malloc(sizeof(LogRecord) * RINETD_LOG_RING_SIZE);
+	}
+	if (!ring || !ring->records) {
+		syslog(LOG_ERR, "not enough memory to log connections.\n");
+		free(ring);
+		return NULL;
+	}
+	/* Rings are never freed, since the writer may be reading them */
+	ring->next = __atomic_load_n(&logRings, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&logRings, &ring->next, ring,
+			0, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+	}
+	logRing = ring;
+	return ring;
+}
+
+/* Format and write all pending records. Returns how many there were. */
+static int logDrain(void)
+{
+	int count = 0;
+	LogRing *ring = __atomic_load_n(&logRings, __ATOMIC_ACQUIRE);
+	for (; ring; ring = ring->next) {
+		unsigned head = ring->head;
+		unsigned tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+		for (; head != tail; ++head, ++count) {
+			logFormatRecord(&ring->records[head % RINETD_LOG_RING_SIZE]);
+			__atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+		}
+	}
+	logWrite();
+
+	unsigned long long dropped = logDroppedCount();
+	if (dropped != logDroppedReported) {
+		syslog(LOG_ERR, "log writer too slow, %llu records dropped\n",
+			dropped - logDroppedReported);
+		logDroppedReported = dropped;
+	}
+	return count;
+}
+
+static void logFormatRecord(LogRecord const *record)
+{
+	char const *addressText = "?";
+	if (record->connection) {
+		addressText = inet_ntoa(record->address);
+	}
+
+	char const *fromHost = "?";
+	int fromPort = 0;
+	char const *toHost =  "?";
+	int toPort =  0;
+	if (record->server >= 0 && record->server < allServersCount) {
+		ServerInfo const *srv = &allServers[record->server];
+		fromHost = srv->fromHost;
+		fromPort = srv->fromPort;
+		toHost = srv->toHost;
+		toPort = srv->toPort;
+		if (record->backend >= 0 && record->backend < srv->backendCount) {
+			toHost = srv->backends[record->backend].host;
+			toPort = srv->backends[record->backend].portNum;
+		}
+	}
+
+	int result = record->result;
+	if (result==logNotAllowed || result==logDenied)
+		syslog(LOG_INFO, "%s %s\n"
+			, addressText
+			, logMessages[result]);
+	if (!logFile) {
+		return;
+	}
+
+	/* Hosts are at most 255 characters long */
+	if (logBufferLength > (int)sizeof(logBuffer) - 1024) {
+		logWrite();
+	}
+	char *line = logBuffer + logBufferLength;
+	int size = (int)sizeof(logBuffer) - logBufferLength;
+	int length;
+	if (logFormat == logFormatBinary) {
+		length = logFormatBinaryRecord(line, size, record, result,
+			fromHost, fromPort, toHost, toPort);
+	} else if (logFormat == logFormatJson) {
+		/* Host names only ever contain letters, digits and "-_.",
+			so nothing needs escaping. Result messages lose the
+			dash that fills the URL of the common log format. */
+		long long duration = record->endTime - record->startTime;
+		duration = duration < 0 ? 0 : duration;
+		length = snprintf(line, size, "{\"start\":%lld.%06d,"
+				"\"end\":%lld.%06d,\"duration\":%lld.%06d,"
+				"\"client\":\"%s\",\"bindHost\":\"%s\","
+				"\"bindPort\":%d,\"connectHost\":\"%s\","
+				"\"connectPort\":%d,\"bytesIn\":%llu,"
+				"\"bytesOut\":%llu,\"result\":\"%.*s\"}\n",
+			record->startTime / 1000000,
+			(int)(record->startTime % 1000000),
+			record->endTime / 1000000,
+			(int)(record->endTime % 1000000),
+			duration / 1000000, (int)(duration % 1000000),
+			addressText,
+			fromHost, fromPort,
+			toHost, toPort,
+			record->bytesInput,
+			record->bytesOutput,
+			(int)strcspn(logMessages[result], " "),
+			logMessages[result]);
+	} else {
+		/* Bit of borrowing from Apache logging module here,
+			thanks folks */
+		time_t now = (time_t)(record->endTime / 1000000);
+		if (now != logStampTime) {
+			struct tm tm;
+			struct tm *t = get_gmtoff(&logStampZone, &tm, now);
+			strftime(logStamp, sizeof(logStamp),
+				"%d/%b/%Y:%H:%M:%S ", t);
+			logStampTime = now;
+		}
+		length = logFormatText(line, size, record, result,
+			addressText, fromHost, fromPort, toHost, toPort);
+	}
+	if (length > 0) {
+		logBufferLength += length < size ? length : size - 1;
+	}
+}
+
+static int logFormatText(char *line, int size,
+	LogRecord const *record, int result, char const *addressText,
+	char const *fromHost, int fromPort, char const *toHost, int toPort)
+{
+	int timz = logStampZone;
+	char sign = (timz < 0 ? '-' : '+');
+	if (timz < 0) {
+		timz = -timz;
+	}
+
+	if (logFormat == logFormatCommon) {
+		/* Fake a common log format log file in a way that
+			most web analyzers can do something interesting with.
+			We lie and say the protocol is HTTP because we don't
+			want the web analyzer to reject the line. We also
+			lie and claim success (code 200) because we don't
+			want the web analyzer to ignore the line as an
+			error and not analyze the "URL." We put a result
+			message into our "URL" instead. The last field
+			is an extra, giving the number of input bytes,
+			after several placeholders meant to fill the
+			positions frequently occupied by user agent,
+			referrer, and server name information. */
+		return snprintf(line, size, "%s - - "
+			"[%s %c%.2d%.2d] "
+			"\"GET /rinetd-services/%s/%d/%s/%d/%s HTTP/1.0\" "
+			"200 %llu - - - %llu\n",
+			addressText,
+			logStamp,
+			sign,
+			timz / 60,
+			timz % 60,
+			fromHost, fromPort,
+			toHost, toPort,
+			logMessages[result],
+			record->bytesOutput,
+			record->bytesInput);
+	}
+	/* Write an rinetd-specific log entry with a
+		less goofy format. */
+	return snprintf(line, size, "%s\t%s\t%s\t%d\t%s\t%d\t%llu"
+			"\t%llu\t%s\n",
+		logStamp,
+		addressText,
+		fromHost, fromPort,
+		toHost, toPort,
+		record->bytesInput,
+		record->bytesOutput,
+		logMessages[result]);
+}
+
+static char *logPutInteger(char *p, unsigned long long value, int bytes)
+{
+	for (int i = bytes - 1; i >= 0; --i) {
+		p[i] = (char)(value & 0xff);
+		value >>= 8;
+	}
+	return p + bytes;
+}
+
+static char *logPutString(char *p, char const *text)
+{
+	size_t length = strlen(text);
+	length = length > 255 ? 255 : length;
+	*p++ = (char)length;
+	memcpy(p, text, length);
+	return p + length;
+}
+
+/* See log.h for the layout */
+static int logFormatBinaryRecord(char *line, int size,
+	LogRecord const *record, int result,
+	char const *fromHost, int fromPort, char const *toHost, int toPort)
+{
+	/* Both hosts fit in what logFormatRecord() leaves us */
+	(void)size;
+	char *p = line + 2;
+	p = logPutInteger(p, 1, 1);
+	p = logPutInteger(p, (unsigned)result, 1);
+	p = logPutInteger(p, (unsigned long long)record->startTime, 8);
+	p = logPutInteger(p, (unsigned long long)record->endTime, 8);
+	p = logPutInteger(p, record->bytesInput, 8);
+	p = logPutInteger(p, record->bytesOutput, 8);
+	if (record->connection) {
+		memcpy(p, &record->address, 4);
+	} else {
+		memset(p, 0, 4);
+	}
+	p += 4;
+	p = logPutInteger(p, (unsigned)fromPort, 2);
+	p = logPutInteger(p, (unsigned)toPort, 2);
+	p = logPutString(p, fromHost);
+	p = logPutString(p, toHost);
+	logPutInteger(line, (unsigned)(p - line), 2);
+	return (int)(p - line);
+}
+
+static void logWrite(void)
+{
+	/* The log file is unbuffered, so this is a single write */
+	if (logFile && logBufferLength > 0) {
+		fwrite(logBuffer, 1, logBufferLength, logFile);
+	}
+	logBufferLength = 0;
+}
+
+/* get_gmtoff was borrowed from Apache. Thanks folks. */
+
+static struct tm *get_gmtoff(int *tz, struct tm *t, time_t tt)
+{
+	/* Assume we are never more than 24 hours away. */
+#if HAVE_GMTIME_R && HAVE_LOCALTIME_R
+	struct tm gmt;
+	gmtime_r(&tt, &gmt);
+	localtime_r(&tt, t);
+#else
+	struct tm gmt = *gmtime(&tt); /* remember gmtime/localtime return ptr to static */
+	*t = *localtime(&tt); /* buffer... so be careful */
+#endif
+	int days = t->tm_yday - gmt.tm_yday;
+	int hours = ((days < -1 ? 24 : 1 < days ? -24 : days * 24)
+		+ t->tm_hour - gmt.tm_hour);
+	int minutes = hours * 60 + t->tm_min - gmt.tm_min;
+	*tz = minutes;
+	return t;
+}
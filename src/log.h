@@ -0,0 +1,57 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Access log. Workers push records into a ring of their own without
+	ever blocking, and a writer thread formats and writes them in
+	batches. Without threads, this happens at the end of each pass of
+	the event loop instead. Records that do not fit are dropped and
+	counted. */
+
+enum {
+	logFormatTab = 0,
+	logFormatCommon,
+	logFormatJson,
+	logFormatBinary,
+};
+
+/* Binary records are made of the following fields, with all integers
+	in network byte order:
+
+	uint16 record length, including this field
+	uint8 format version, currently 1
+	uint8 result, see below
+	uint64 start and end times, in microseconds since the epoch
+	uint64 bytes received from and sent to the client
+	4 bytes client IPv4 address, or zeroes if unknown
+	uint16 bind port and connect port
+	uint8 bind host length, then the bind host
+	uint8 connect host length, then the connect host */
+
+enum {
+	logUnknownError = 0,
+	logLocalClosedFirst,
+	logRemoteClosedFirst,
+	logAcceptFailed,
+	logLocalSocketFailed,
+	logLocalBindFailed,
+	logLocalConnectFailed,
+	logOpened,
+	logAllowed,
+	logNotAllowed,
+	logDenied,
+};
+
+long long logClock(void);
+void logStart(void);
+void logPush(LogRecord const *record);
+void logPass(void);
+void logPause(void);
+void logResume(void);
+unsigned long long logDroppedCount(void);
@@ -10,6 +10,10 @@
 #	include <config.h>
 #endif
 
+#if !_WIN32
+#	include <netinet/tcp.h>
+#endif
+
 #include "net.h"
 
 void setSocketDefaults(SOCKET fd)
@@ -33,3 +37,19 @@ void setSocketDefaults(SOCKET fd)
 #endif
 }
 
+/* Smoothed round-trip time of a TCP socket in microseconds, or 0 if
+	unknown */
+int getSocketRtt(SOCKET fd)
+{
+#if defined TCP_INFO && defined __linux__
+	struct tcp_info info;
+	SOCKLEN_T len = sizeof(info);
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0) {
+		return (int)info.tcpi_rtt;
+	}
+#else
+	(void)fd;
+#endif
+	return 0;
+}
+
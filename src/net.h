@@ -20,6 +20,7 @@
 #	include <netdb.h>
 #	include <netinet/in.h>
 #	include <arpa/inet.h>
+#	include <sys/uio.h>
 #endif
 
 #if defined HAVE_ERRNO_H
@@ -53,6 +54,11 @@
 #	ifndef WSAEAGAIN
 #		define WSAEAGAIN WSAEWOULDBLOCK
 #	endif
+	/* Nor scatter/gather I/O, but we use its buffer lists */
+struct iovec {
+	void *iov_base;
+	size_t iov_len;
+};
 #else
 	/* Windows sockets compatibility defines */
 #	define INVALID_SOCKET (-1)
@@ -64,6 +70,7 @@ static inline int closesocket(int s) {
 #	define WSAEAGAIN EAGAIN
 #	define WSAEINPROGRESS EINPROGRESS
 #	define WSAEINTR EINTR
+#	define WSAETIMEDOUT ETIMEDOUT
 #	define SOCKET int
 static inline int GetLastError(void) {
 	return errno;
@@ -71,4 +78,5 @@ static inline int GetLastError(void) {
 #endif /* _WIN32 */
 
 void setSocketDefaults(SOCKET fd);
+int getSocketRtt(SOCKET fd);
 
@@ -3,7 +3,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#define YYRULECOUNT 36
+#define YYRULECOUNT 64
 #line 9 "parse.peg"
 
 #if HAVE_CONFIG_H
@@ -14,6 +14,7 @@
 #include "types.h"
 #include "rinetd.h"
 #include "parse.h"
+#include "log.h"
 
 #define YY_CTX_LOCAL 1
 #define YY_CTX_MEMBERS \
@@ -21,10 +22,13 @@
 	int currentLine; \
 	int isAuthAllow; \
 	char *tmpPort; \
-	int tmpPortNum, tmpProto; \
+	int tmpPortNum, tmpProto, tmpSize; \
 	int bindPortNum, bindProto, connectPortNum, connectProto; \
-	int serverTimeout; \
-	char *bindAddress, *connectAddress, *sourceAddress;
+	int serverTimeout, udpBatch, bufferMin, bufferMax, balance, weight; \
+	int checkInterval, checkRise, checkFall; \
+	int ejectFailures, ejectTime, connectTimeout, retries; \
+	char *bindAddress, *connectAddress, *sourceAddress; \
+	char *checkSend, *checkExpect, *tmpString;
 #define YY_INPUT(yyctx, buf, result, max_size) \
 { \
 	int yyc = fgetc(yyctx->fp); \
@@ -309,34 +313,62 @@ YY_LOCAL(void) yySet(yycontext *yy, char *text, int count)   { yy->__val[count]=
 
 #define	YYACCEPT	yyAccept(yy, yythunkpos0)
 
-YY_RULE(int) yy_eof(yycontext *yy); /* 36 */
-YY_RULE(int) yy_digit(yycontext *yy); /* 35 */
-YY_RULE(int) yy_hostname(yycontext *yy); /* 34 */
-YY_RULE(int) yy_ipv4(yycontext *yy); /* 33 */
-YY_RULE(int) yy_name(yycontext *yy); /* 32 */
-YY_RULE(int) yy_filename(yycontext *yy); /* 31 */
-YY_RULE(int) yy_pattern(yycontext *yy); /* 30 */
-YY_RULE(int) yy_auth_key(yycontext *yy); /* 29 */
-YY_RULE(int) yy_service(yycontext *yy); /* 28 */
-YY_RULE(int) yy_proto(yycontext *yy); /* 27 */
-YY_RULE(int) yy_port(yycontext *yy); /* 26 */
-YY_RULE(int) yy_number(yycontext *yy); /* 25 */
-YY_RULE(int) yy_option_source(yycontext *yy); /* 24 */
-YY_RULE(int) yy_option_timeout(yycontext *yy); /* 23 */
-YY_RULE(int) yy_option(yycontext *yy); /* 22 */
-YY_RULE(int) yy_option_list(yycontext *yy); /* 21 */
-YY_RULE(int) yy_full_port(yycontext *yy); /* 20 */
-YY_RULE(int) yy_address(yycontext *yy); /* 19 */
-YY_RULE(int) yy_server_options(yycontext *yy); /* 18 */
-YY_RULE(int) yy_connect_port(yycontext *yy); /* 17 */
-YY_RULE(int) yy_connect_address(yycontext *yy); /* 16 */
-YY_RULE(int) yy_bind_port(yycontext *yy); /* 15 */
-YY_RULE(int) yy_bind_address(yycontext *yy); /* 14 */
-YY_RULE(int) yy_logcommon(yycontext *yy); /* 13 */
-YY_RULE(int) yy_pidlogfile(yycontext *yy); /* 12 */
-YY_RULE(int) yy_logfile(yycontext *yy); /* 11 */
-YY_RULE(int) yy_auth_rule(yycontext *yy); /* 10 */
-YY_RULE(int) yy_server_rule(yycontext *yy); /* 9 */
+YY_RULE(int) yy_eof(yycontext *yy); /* 64 */
+YY_RULE(int) yy_digit(yycontext *yy); /* 63 */
+YY_RULE(int) yy_hostname(yycontext *yy); /* 62 */
+YY_RULE(int) yy_ipv4(yycontext *yy); /* 61 */
+YY_RULE(int) yy_name(yycontext *yy); /* 60 */
+YY_RULE(int) yy_flight_duration(yycontext *yy); /* 59 */
+YY_RULE(int) yy_flight_latency(yycontext *yy); /* 58 */
+YY_RULE(int) yy_log_format(yycontext *yy); /* 57 */
+YY_RULE(int) yy_filename(yycontext *yy); /* 56 */
+YY_RULE(int) yy_pattern(yycontext *yy); /* 55 */
+YY_RULE(int) yy_auth_key(yycontext *yy); /* 54 */
+YY_RULE(int) yy_service(yycontext *yy); /* 53 */
+YY_RULE(int) yy_proto(yycontext *yy); /* 52 */
+YY_RULE(int) yy_port(yycontext *yy); /* 51 */
+YY_RULE(int) yy_size(yycontext *yy); /* 50 */
+YY_RULE(int) yy_string(yycontext *yy); /* 49 */
+YY_RULE(int) yy_balance(yycontext *yy); /* 48 */
+YY_RULE(int) yy_number(yycontext *yy); /* 47 */
+YY_RULE(int) yy_option_retries(yycontext *yy); /* 46 */
+YY_RULE(int) yy_option_connecttimeout(yycontext *yy); /* 45 */
+YY_RULE(int) yy_option_eject(yycontext *yy); /* 44 */
+YY_RULE(int) yy_option_ejecttime(yycontext *yy); /* 43 */
+YY_RULE(int) yy_option_expect(yycontext *yy); /* 42 */
+YY_RULE(int) yy_option_send(yycontext *yy); /* 41 */
+YY_RULE(int) yy_option_fall(yycontext *yy); /* 40 */
+YY_RULE(int) yy_option_rise(yycontext *yy); /* 39 */
+YY_RULE(int) yy_option_check(yycontext *yy); /* 38 */
+YY_RULE(int) yy_option_balance(yycontext *yy); /* 37 */
+YY_RULE(int) yy_option_maxbuf(yycontext *yy); /* 36 */
+YY_RULE(int) yy_option_minbuf(yycontext *yy); /* 35 */
+YY_RULE(int) yy_option_batch(yycontext *yy); /* 34 */
+YY_RULE(int) yy_option_source(yycontext *yy); /* 33 */
+YY_RULE(int) yy_option_timeout(yycontext *yy); /* 32 */
+YY_RULE(int) yy_option(yycontext *yy); /* 31 */
+YY_RULE(int) yy_option_weight(yycontext *yy); /* 30 */
+YY_RULE(int) yy_option_list(yycontext *yy); /* 29 */
+YY_RULE(int) yy_full_port(yycontext *yy); /* 28 */
+YY_RULE(int) yy_address(yycontext *yy); /* 27 */
+YY_RULE(int) yy_backend_options(yycontext *yy); /* 26 */
+YY_RULE(int) yy_server_options(yycontext *yy); /* 25 */
+YY_RULE(int) yy_connect_port(yycontext *yy); /* 24 */
+YY_RULE(int) yy_connect_address(yycontext *yy); /* 23 */
+YY_RULE(int) yy_bind_port(yycontext *yy); /* 22 */
+YY_RULE(int) yy_bind_address(yycontext *yy); /* 21 */
+YY_RULE(int) yy_workers(yycontext *yy); /* 20 */
+YY_RULE(int) yy_flightrecorder(yycontext *yy); /* 19 */
+YY_RULE(int) yy_watchdog(yycontext *yy); /* 18 */
+YY_RULE(int) yy_statsfile(yycontext *yy); /* 17 */
+YY_RULE(int) yy_stats(yycontext *yy); /* 16 */
+YY_RULE(int) yy_logformat(yycontext *yy); /* 15 */
+YY_RULE(int) yy_logcommon(yycontext *yy); /* 14 */
+YY_RULE(int) yy_pidlogfile(yycontext *yy); /* 13 */
+YY_RULE(int) yy_logfile(yycontext *yy); /* 12 */
+YY_RULE(int) yy_auth_rule(yycontext *yy); /* 11 */
+YY_RULE(int) yy_server_rule(yycontext *yy); /* 10 */
+YY_RULE(int) yy_backend(yycontext *yy); /* 9 */
 YY_RULE(int) yy_comment(yycontext *yy); /* 8 */
 YY_RULE(int) yy_command(yycontext *yy); /* 7 */
 YY_RULE(int) yy__(yycontext *yy); /* 6 */
@@ -353,7 +385,7 @@ YY_ACTION(void) yy_1_sol(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_sol\n"));
   {
-#line 156
+#line 383
    ++yy->currentLine; ;
   }
 #undef yythunkpos
@@ -367,7 +399,7 @@ YY_ACTION(void) yy_1_invalid_syntax(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_invalid_syntax\n"));
   {
-#line 135
+#line 362
   
 	fprintf(stderr, "rinetd: invalid syntax at line %d: %s\n",
 	        yy->currentLine, yytext);
@@ -378,6 +410,219 @@ YY_ACTION(void) yy_1_invalid_syntax(yycontext *yy, char *yytext, int yyleng)
 #undef yypos
 #undef yy
 }
+YY_ACTION(void) yy_1_workers(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_workers\n"));
+  {
+#line 352
+  
+	workerCount = atoi(yytext);
+	if (workerCount < 1 || workerCount > RINETD_MAX_WORKERS) {
+		syslog(LOG_ERR, "number of workers %s out of range (1-%d)\n",
+			yytext, RINETD_MAX_WORKERS);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_flight_duration(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_flight_duration\n"));
+  {
+#line 342
+  
+	flightDuration = atoi(yytext);
+	if (flightDuration < 1 || flightDuration > 86400000) {
+		syslog(LOG_ERR, "flight recorder duration %s out of range "
+			"(1-86400000)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_flight_latency(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_flight_latency\n"));
+  {
+#line 333
+  
+	flightLatency = atoi(yytext);
+	if (flightLatency < 0 || flightLatency > 3600000) {
+		syslog(LOG_ERR, "flight recorder latency %s out of range "
+			"(0-3600000)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_flightrecorder(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_flightrecorder\n"));
+  {
+#line 326
+  
+	if (!flightLatency && !flightDuration) {
+		syslog(LOG_ERR, "flight recorder without a threshold\n");
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_watchdog(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_watchdog\n"));
+  {
+#line 316
+  
+	watchdogThreshold = atoi(yytext);
+	if (watchdogThreshold < 1 || watchdogThreshold > 3600000) {
+		syslog(LOG_ERR, "watchdog threshold %s out of range "
+			"(1-3600000)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_statsfile(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_statsfile\n"));
+  {
+#line 308
+  
+	statsFileName = strdup(yytext);
+	if (!statsFileName) {
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_stats(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_stats\n"));
+  {
+#line 298
+  
+	if (yy->tmpProto != protoTcp) {
+		syslog(LOG_ERR, "the stats listener only uses TCP\n");
+		PARSE_ERROR;
+	}
+	addStatsServer(yy->bindAddress, yy->tmpPortNum);
+	yy->bindAddress = NULL;
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_4_log_format(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_4_log_format\n"));
+  {
+#line 295
+   logFormat = logFormatBinary; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_3_log_format(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_3_log_format\n"));
+  {
+#line 294
+   logFormat = logFormatJson; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_2_log_format(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_2_log_format\n"));
+  {
+#line 293
+   logFormat = logFormatCommon; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_log_format(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_log_format\n"));
+  {
+#line 292
+   logFormat = logFormatTab; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_logformat(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_logformat\n"));
+  {
+#line 291
+   logCloseOnly = 1; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
 YY_ACTION(void) yy_1_logcommon(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
@@ -385,9 +630,9 @@ YY_ACTION(void) yy_1_logcommon(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_logcommon\n"));
   {
-#line 130
+#line 287
   
-	logFormatCommon = 1;
+	logFormat = logFormatCommon;
 ;
   }
 #undef yythunkpos
@@ -401,7 +646,7 @@ YY_ACTION(void) yy_1_pidlogfile(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_pidlogfile\n"));
   {
-#line 122
+#line 279
   
 	pidLogFileName = strdup(yytext);
 	if (!pidLogFileName) {
@@ -420,7 +665,7 @@ YY_ACTION(void) yy_1_logfile(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_logfile\n"));
   {
-#line 114
+#line 271
   
 	logFileName = strdup(yytext);
 	if (!logFileName) {
@@ -439,7 +684,7 @@ YY_ACTION(void) yy_1_auth_key(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_auth_key\n"));
   {
-#line 111
+#line 268
    yy->isAuthAllow = (yytext[0] == 'a'); ;
   }
 #undef yythunkpos
@@ -453,7 +698,7 @@ YY_ACTION(void) yy_1_auth_rule(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_auth_rule\n"));
   {
-#line 89
+#line 246
   
 	allRules = (Rule *)
 		realloc(allRules, sizeof(Rule) * (allRulesCount + 1));
@@ -465,11 +710,11 @@ YY_ACTION(void) yy_1_auth_rule(yycontext *yy, char *yytext, int yyleng)
 		PARSE_ERROR;
 	}
 	allRules[allRulesCount].type = yy->isAuthAllow ? allowRule : denyRule;
-	if (seTotal > 0) {
-		if (seInfo[seTotal - 1].rulesStart == 0) {
-			seInfo[seTotal - 1].rulesStart = allRulesCount;
+	if (allServersCount > 0) {
+		if (allServers[allServersCount - 1].rulesStart == 0) {
+			allServers[allServersCount - 1].rulesStart = allRulesCount;
 		}
-		++seInfo[seTotal - 1].rulesCount;
+		++allServers[allServersCount - 1].rulesCount;
 	} else {
 		++globalRulesCount;
 	}
@@ -487,7 +732,7 @@ YY_ACTION(void) yy_3_proto(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_3_proto\n"));
   {
-#line 86
+#line 243
    yy->tmpProto = protoTcp; ;
   }
 #undef yythunkpos
@@ -501,7 +746,7 @@ YY_ACTION(void) yy_2_proto(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_2_proto\n"));
   {
-#line 85
+#line 242
    yy->tmpProto = protoUdp; ;
   }
 #undef yythunkpos
@@ -515,7 +760,7 @@ YY_ACTION(void) yy_1_proto(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_proto\n"));
   {
-#line 84
+#line 241
    yy->tmpProto = protoTcp; ;
   }
 #undef yythunkpos
@@ -529,7 +774,7 @@ YY_ACTION(void) yy_1_port(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_port\n"));
   {
-#line 83
+#line 240
    yy->tmpPort = strdup(yytext); ;
   }
 #undef yythunkpos
@@ -543,7 +788,7 @@ YY_ACTION(void) yy_1_full_port(yycontext *yy, char *yytext, int yyleng)
 #define yythunkpos yy->__thunkpos
   yyprintf((stderr, "do yy_1_full_port\n"));
   {
-#line 73
+#line 230
   
 	char const *proto = yy->tmpProto == protoTcp ? "tcp" : "udp";
 	struct servent *service = getservbyname(yy->tmpPort, proto);
@@ -558,462 +803,1385 @@ YY_ACTION(void) yy_1_full_port(yycontext *yy, char *yytext, int yyleng)
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_option_source(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_1_size(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_option_source\n"));
+  yyprintf((stderr, "do yy_1_size\n"));
   {
-#line 70
-   yy->sourceAddress = strdup(yytext); ;
+#line 212
+  
+	/* Round up to a power of two, for the buffer pool */
+	long value = strtol(yytext, NULL, 10);
+	char unit = yytext[strlen(yytext) - 1];
+	value *= unit == 'k' || unit == 'K' ? 1024
+		: unit == 'm' || unit == 'M' ? 1048576 : 1;
+	if (value < RINETD_MIN_BUFFER_SIZE || value > RINETD_MAX_BUFFER_SIZE) {
+		syslog(LOG_ERR, "buffer size %s out of range (%dk-%dm)\n", yytext,
+			RINETD_MIN_BUFFER_SIZE / 1024, RINETD_MAX_BUFFER_SIZE / 1048576);
+		PARSE_ERROR;
+	}
+	yy->tmpSize = RINETD_MIN_BUFFER_SIZE;
+	while (yy->tmpSize < value) {
+		yy->tmpSize <<= 1;
+	}
+;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_option_timeout(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_2_string(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_option_timeout\n"));
+  yyprintf((stderr, "do yy_2_string\n"));
   {
-#line 69
-   yy->serverTimeout = atoi(yytext); ;
+#line 209
+   yy->tmpString = strdup(yytext); ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_connect_port(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_1_string(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_connect_port\n"));
+  yyprintf((stderr, "do yy_1_string\n"));
   {
-#line 64
-   yy->connectPortNum = yy->tmpPortNum; yy->connectProto = yy->tmpProto; ;
+#line 208
+   yy->tmpString = strdup(yytext); ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_bind_port(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_4_balance(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_bind_port\n"));
+  yyprintf((stderr, "do yy_4_balance\n"));
   {
-#line 63
-   yy->bindPortNum = yy->tmpPortNum; yy->bindProto = yy->tmpProto; ;
+#line 206
+   yy->balance = balanceHash; ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_connect_address(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_3_balance(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_connect_address\n"));
+  yyprintf((stderr, "do yy_3_balance\n"));
   {
-#line 62
-   yy->connectAddress = strdup(yytext); ;
+#line 205
+   yy->balance = balancePowerOfTwo; ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_bind_address(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_2_balance(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_bind_address\n"));
+  yyprintf((stderr, "do yy_2_balance\n"));
   {
-#line 61
-   yy->bindAddress = strdup(yytext); ;
+#line 204
+   yy->balance = balanceLeastConnections; ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-YY_ACTION(void) yy_1_server_rule(yycontext *yy, char *yytext, int yyleng)
+YY_ACTION(void) yy_1_balance(yycontext *yy, char *yytext, int yyleng)
 {
 #define __ yy->__
 #define yypos yy->__pos
 #define yythunkpos yy->__thunkpos
-  yyprintf((stderr, "do yy_1_server_rule\n"));
+  yyprintf((stderr, "do yy_1_balance\n"));
+  {
+#line 203
+   yy->balance = balanceRoundRobin; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_maxbuf(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_maxbuf\n"));
+  {
+#line 201
+   yy->bufferMax = yy->tmpSize; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_minbuf(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_minbuf\n"));
+  {
+#line 200
+   yy->bufferMin = yy->tmpSize; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_retries(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_retries\n"));
   {
-#line 52
+#line 193
   
-	addServer(yy->bindAddress, yy->bindPortNum, yy->bindProto,
-		yy->connectAddress, yy->connectPortNum, yy->connectProto,
-		yy->serverTimeout > 0 ? yy->serverTimeout : RINETD_DEFAULT_UDP_TIMEOUT,
-		yy->sourceAddress);
-	yy->bindAddress = yy->connectAddress = yy->sourceAddress = NULL;
-	yy->serverTimeout = 0;
+	yy->retries = atoi(yytext);
+	if (yy->retries < 1 || yy->retries > 100) {
+		syslog(LOG_ERR, "retries %s out of range (1-100)\n", yytext);
+		PARSE_ERROR;
+	}
 ;
   }
 #undef yythunkpos
 #undef yypos
 #undef yy
 }
-
-YY_RULE(int) yy_eof(yycontext *yy)
-{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "eof"));  if (!yymatchChar(yy, '\0')) goto l1;
-  yyprintf((stderr, "  ok   %s @ %s\n", "eof", yy->__buf+yy->__pos));
+YY_ACTION(void) yy_1_option_connecttimeout(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_connecttimeout\n"));
+  {
+#line 184
+  
+	yy->connectTimeout = atoi(yytext);
+	if (yy->connectTimeout < 1 || yy->connectTimeout > 3600) {
+		syslog(LOG_ERR, "connect timeout %s out of range (1-3600)\n",
+			yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_ejecttime(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_ejecttime\n"));
+  {
+#line 175
+  
+	yy->ejectTime = atoi(yytext);
+	if (yy->ejectTime < 1 || yy->ejectTime > RINETD_MAX_EJECT_TIME) {
+		syslog(LOG_ERR, "eject time %s out of range (1-%d)\n",
+			yytext, RINETD_MAX_EJECT_TIME);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_eject(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_eject\n"));
+  {
+#line 167
+  
+	yy->ejectFailures = atoi(yytext);
+	if (yy->ejectFailures < 1 || yy->ejectFailures > 1000) {
+		syslog(LOG_ERR, "eject count %s out of range (1-1000)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_expect(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_expect\n"));
+  {
+#line 165
+   yy->checkExpect = yy->tmpString; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_send(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_send\n"));
+  {
+#line 164
+   yy->checkSend = yy->tmpString; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_fall(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_fall\n"));
+  {
+#line 157
+  
+	yy->checkFall = atoi(yytext);
+	if (yy->checkFall < 1 || yy->checkFall > 100) {
+		syslog(LOG_ERR, "fall count %s out of range (1-100)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_rise(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_rise\n"));
+  {
+#line 149
+  
+	yy->checkRise = atoi(yytext);
+	if (yy->checkRise < 1 || yy->checkRise > 100) {
+		syslog(LOG_ERR, "rise count %s out of range (1-100)\n", yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_check(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_check\n"));
+  {
+#line 140
+  
+	yy->checkInterval = atoi(yytext);
+	if (yy->checkInterval < 1 || yy->checkInterval > 3600) {
+		syslog(LOG_ERR, "check interval %s out of range (1-3600)\n",
+			yytext);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_weight(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_weight\n"));
+  {
+#line 131
+  
+	yy->weight = atoi(yytext);
+	if (yy->weight < 1 || yy->weight > RINETD_MAX_WEIGHT) {
+		syslog(LOG_ERR, "weight %s out of range (1-%d)\n",
+			yytext, RINETD_MAX_WEIGHT);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_batch(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_batch\n"));
+  {
+#line 121
+  
+	yy->udpBatch = atoi(yytext);
+	if (yy->udpBatch < 1 || yy->udpBatch > RINETD_MAX_UDP_BATCH) {
+		syslog(LOG_ERR, "batch size %s out of range (1-%d)\n",
+			yytext, RINETD_MAX_UDP_BATCH);
+		PARSE_ERROR;
+	}
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_source(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_source\n"));
+  {
+#line 119
+   yy->sourceAddress = strdup(yytext); ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_option_timeout(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_option_timeout\n"));
+  {
+#line 118
+   yy->serverTimeout = atoi(yytext); ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_connect_port(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_connect_port\n"));
+  {
+#line 107
+   yy->connectPortNum = yy->tmpPortNum; yy->connectProto = yy->tmpProto; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_bind_port(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_bind_port\n"));
+  {
+#line 106
+   yy->bindPortNum = yy->tmpPortNum; yy->bindProto = yy->tmpProto; ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_connect_address(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_connect_address\n"));
+  {
+#line 105
+   yy->connectAddress = strdup(yytext); ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_bind_address(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_bind_address\n"));
+  {
+#line 104
+   yy->bindAddress = strdup(yytext); ;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_backend(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_backend\n"));
+  {
+#line 93
+  
+	if (allServersCount == 0) {
+		syslog(LOG_ERR, "backend without a forwarding rule\n");
+		PARSE_ERROR;
+	}
+	addBackend(yy->connectAddress, yy->connectPortNum, yy->connectProto,
+		yy->weight > 0 ? yy->weight : 1);
+	yy->connectAddress = NULL;
+	yy->weight = 0;
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+YY_ACTION(void) yy_1_server_rule(yycontext *yy, char *yytext, int yyleng)
+{
+#define __ yy->__
+#define yypos yy->__pos
+#define yythunkpos yy->__thunkpos
+  yyprintf((stderr, "do yy_1_server_rule\n"));
+  {
+#line 56
+  
+	int bufferMin = yy->bufferMin > 0 ? yy->bufferMin : RINETD_MIN_BUFFER_SIZE;
+	int bufferMax = yy->bufferMax > 0 ? yy->bufferMax
+		: RINETD_DEFAULT_MAX_BUFFER_SIZE > bufferMin
+		? RINETD_DEFAULT_MAX_BUFFER_SIZE : bufferMin;
+	if (bufferMin > bufferMax) {
+		syslog(LOG_ERR, "minbuf is larger than maxbuf\n");
+		PARSE_ERROR;
+	}
+	addServer(yy->bindAddress, yy->bindPortNum, yy->bindProto,
+		yy->connectAddress, yy->connectPortNum, yy->connectProto,
+		yy->serverTimeout > 0 ? yy->serverTimeout : RINETD_DEFAULT_UDP_TIMEOUT,
+		yy->udpBatch > 0 ? yy->udpBatch : 1,
+		bufferMin, bufferMax,
+		yy->sourceAddress,
+		yy->balance > 0 ? yy->balance : balanceRoundRobin,
+		yy->weight > 0 ? yy->weight : 1);
+	ServerInfo *srv = &allServers[allServersCount - 1];
+	srv->checkInterval = yy->checkInterval;
+	srv->checkRise = yy->checkRise > 0 ? yy->checkRise : 2;
+	srv->checkFall = yy->checkFall > 0 ? yy->checkFall : 3;
+	srv->checkSend = yy->checkSend;
+	srv->checkExpect = yy->checkExpect;
+	srv->ejectFailures = yy->ejectFailures;
+	srv->ejectTime = yy->ejectTime > 0 ? yy->ejectTime : 10;
+	srv->connectTimeout = yy->connectTimeout;
+	srv->retries = yy->retries;
+	yy->bindAddress = yy->connectAddress = yy->sourceAddress = NULL;
+	yy->serverTimeout = yy->udpBatch = yy->bufferMin = yy->bufferMax = 0;
+	yy->balance = yy->weight = 0;
+	yy->checkInterval = yy->checkRise = yy->checkFall = 0;
+	yy->checkSend = yy->checkExpect = NULL;
+	yy->ejectFailures = yy->ejectTime = yy->connectTimeout = 0;
+	yy->retries = 0;
+;
+  }
+#undef yythunkpos
+#undef yypos
+#undef yy
+}
+
+YY_RULE(int) yy_eof(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "eof"));  if (!yymatchChar(yy, '\0')) goto l1;
+  yyprintf((stderr, "  ok   %s @ %s\n", "eof", yy->__buf+yy->__pos));
+  return 1;
+  l1:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "eof", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_digit(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "digit"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l2;
+  yyprintf((stderr, "  ok   %s @ %s\n", "digit", yy->__buf+yy->__pos));
+  return 1;
+  l2:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "digit", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_hostname(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "hostname"));
+  l4:;	
+  {  int yypos5= yy->__pos, yythunkpos5= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l5;
+  l6:;	
+  {  int yypos7= yy->__pos, yythunkpos7= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l7;  goto l6;
+  l7:;	  yy->__pos= yypos7; yy->__thunkpos= yythunkpos7;
+  }  if (!yymatchChar(yy, '.')) goto l5;  goto l4;
+  l5:;	  yy->__pos= yypos5; yy->__thunkpos= yythunkpos5;
+  }  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l3;
+  l8:;	
+  {  int yypos9= yy->__pos, yythunkpos9= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l9;  goto l8;
+  l9:;	  yy->__pos= yypos9; yy->__thunkpos= yythunkpos9;
+  }
+  {  int yypos10= yy->__pos, yythunkpos10= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l10;  goto l11;
+  l10:;	  yy->__pos= yypos10; yy->__thunkpos= yythunkpos10;
+  }
+  l11:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "hostname", yy->__buf+yy->__pos));
+  return 1;
+  l3:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "hostname", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_ipv4(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "ipv4"));
+  {  int yypos13= yy->__pos, yythunkpos13= yy->__thunkpos;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  goto l13;
+  l14:;	  yy->__pos= yypos13; yy->__thunkpos= yythunkpos13;  if (!yymatchChar(yy, '0')) goto l12;
+  }
+  l13:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "ipv4", yy->__buf+yy->__pos));
+  return 1;
+  l12:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "ipv4", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_name(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "name"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l15;
+  l16:;	
+  {  int yypos17= yy->__pos, yythunkpos17= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l17;  goto l16;
+  l17:;	  yy->__pos= yypos17; yy->__thunkpos= yythunkpos17;
+  }
+  yyprintf((stderr, "  ok   %s @ %s\n", "name", yy->__buf+yy->__pos));
+  return 1;
+  l15:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "name", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_flight_duration(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "flight_duration"));  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l18;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l18;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l18;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_flight_duration, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "flight_duration", yy->__buf+yy->__pos));
+  return 1;
+  l18:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "flight_duration", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_flight_latency(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "flight_latency"));  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l19;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l19;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l19;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_flight_latency, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "flight_latency", yy->__buf+yy->__pos));
+  return 1;
+  l19:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "flight_latency", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_log_format(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "log_format"));
+  {  int yypos21= yy->__pos, yythunkpos21= yy->__thunkpos;  if (!yymatchString(yy, "tab")) goto l22;  yyDo(yy, yy_1_log_format, yy->__begin, yy->__end);  goto l21;
+  l22:;	  yy->__pos= yypos21; yy->__thunkpos= yythunkpos21;  if (!yymatchString(yy, "common")) goto l23;  yyDo(yy, yy_2_log_format, yy->__begin, yy->__end);  goto l21;
+  l23:;	  yy->__pos= yypos21; yy->__thunkpos= yythunkpos21;  if (!yymatchString(yy, "json")) goto l24;  yyDo(yy, yy_3_log_format, yy->__begin, yy->__end);  goto l21;
+  l24:;	  yy->__pos= yypos21; yy->__thunkpos= yythunkpos21;  if (!yymatchString(yy, "binary")) goto l20;  yyDo(yy, yy_4_log_format, yy->__begin, yy->__end);
+  }
+  l21:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "log_format", yy->__buf+yy->__pos));
+  return 1;
+  l20:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "log_format", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_filename(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "filename"));
+  {  int yypos26= yy->__pos, yythunkpos26= yy->__thunkpos;  if (!yymatchChar(yy, '"')) goto l27;  if (!yymatchClass(yy, (unsigned char *)"\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l27;
+  l28:;	
+  {  int yypos29= yy->__pos, yythunkpos29= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l29;  goto l28;
+  l29:;	  yy->__pos= yypos29; yy->__thunkpos= yythunkpos29;
+  }  if (!yymatchChar(yy, '"')) goto l27;  goto l26;
+  l27:;	  yy->__pos= yypos26; yy->__thunkpos= yythunkpos26;  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l25;
+  l30:;	
+  {  int yypos31= yy->__pos, yythunkpos31= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l31;  goto l30;
+  l31:;	  yy->__pos= yypos31; yy->__thunkpos= yythunkpos31;
+  }
+  }
+  l26:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "filename", yy->__buf+yy->__pos));
+  return 1;
+  l25:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "filename", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_pattern(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "pattern"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l32;
+  l33:;	
+  {  int yypos34= yy->__pos, yythunkpos34= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l34;  goto l33;
+  l34:;	  yy->__pos= yypos34; yy->__thunkpos= yythunkpos34;
+  }
+  {  int yypos35= yy->__pos, yythunkpos35= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l35;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l35;
+  l37:;	
+  {  int yypos38= yy->__pos, yythunkpos38= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l38;  goto l37;
+  l38:;	  yy->__pos= yypos38; yy->__thunkpos= yythunkpos38;
+  }
+  {  int yypos39= yy->__pos, yythunkpos39= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l39;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l39;
+  l41:;	
+  {  int yypos42= yy->__pos, yythunkpos42= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l42;  goto l41;
+  l42:;	  yy->__pos= yypos42; yy->__thunkpos= yythunkpos42;
+  }
+  {  int yypos43= yy->__pos, yythunkpos43= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l43;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l43;
+  l45:;	
+  {  int yypos46= yy->__pos, yythunkpos46= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l46;  goto l45;
+  l46:;	  yy->__pos= yypos46; yy->__thunkpos= yythunkpos46;
+  }  goto l44;
+  l43:;	  yy->__pos= yypos43; yy->__thunkpos= yythunkpos43;
+  }
+  l44:;	  goto l40;
+  l39:;	  yy->__pos= yypos39; yy->__thunkpos= yythunkpos39;
+  }
+  l40:;	  goto l36;
+  l35:;	  yy->__pos= yypos35; yy->__thunkpos= yythunkpos35;
+  }
+  l36:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "pattern", yy->__buf+yy->__pos));
+  return 1;
+  l32:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "pattern", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_auth_key(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "auth_key"));  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l47;
+#undef yytext
+#undef yyleng
+  }
+  {  int yypos48= yy->__pos, yythunkpos48= yy->__thunkpos;  if (!yymatchString(yy, "allow")) goto l49;  goto l48;
+  l49:;	  yy->__pos= yypos48; yy->__thunkpos= yythunkpos48;  if (!yymatchString(yy, "deny")) goto l47;
+  }
+  l48:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l47;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_auth_key, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "auth_key", yy->__buf+yy->__pos));
+  return 1;
+  l47:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "auth_key", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_service(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "service"));  if (!yy_name(yy)) goto l50;
+  yyprintf((stderr, "  ok   %s @ %s\n", "service", yy->__buf+yy->__pos));
+  return 1;
+  l50:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "service", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_proto(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "proto"));
+  {  int yypos52= yy->__pos, yythunkpos52= yy->__thunkpos;  if (!yymatchString(yy, "/tcp")) goto l53;  yyDo(yy, yy_1_proto, yy->__begin, yy->__end);  goto l52;
+  l53:;	  yy->__pos= yypos52; yy->__thunkpos= yythunkpos52;  if (!yymatchString(yy, "/udp")) goto l54;  yyDo(yy, yy_2_proto, yy->__begin, yy->__end);  goto l52;
+  l54:;	  yy->__pos= yypos52; yy->__thunkpos= yythunkpos52;  if (!yymatchString(yy, "")) goto l51;  yyDo(yy, yy_3_proto, yy->__begin, yy->__end);
+  }
+  l52:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "proto", yy->__buf+yy->__pos));
+  return 1;
+  l51:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "proto", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_port(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "port"));  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l55;
+#undef yytext
+#undef yyleng
+  }
+  {  int yypos56= yy->__pos, yythunkpos56= yy->__thunkpos;  if (!yy_number(yy)) goto l57;  goto l56;
+  l57:;	  yy->__pos= yypos56; yy->__thunkpos= yythunkpos56;  if (!yy_service(yy)) goto l55;
+  }
+  l56:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l55;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_port, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "port", yy->__buf+yy->__pos));
+  return 1;
+  l55:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "port", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_size(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "size"));  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l58;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l58;
+  {  int yypos59= yy->__pos, yythunkpos59= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\000\000\000\050\000\000\000\050\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l59;  goto l60;
+  l59:;	  yy->__pos= yypos59; yy->__thunkpos= yythunkpos59;
+  }
+  l60:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l58;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_size, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "size", yy->__buf+yy->__pos));
+  return 1;
+  l58:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "size", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_string(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "string"));
+  {  int yypos62= yy->__pos, yythunkpos62= yy->__thunkpos;  if (!yymatchChar(yy, '"')) goto l63;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l63;
+#undef yytext
+#undef yyleng
+  }
+  l64:;	
+  {  int yypos65= yy->__pos, yythunkpos65= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\333\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l65;  goto l64;
+  l65:;	  yy->__pos= yypos65; yy->__thunkpos= yythunkpos65;
+  }  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l63;
+#undef yytext
+#undef yyleng
+  }  if (!yymatchChar(yy, '"')) goto l63;  yyDo(yy, yy_1_string, yy->__begin, yy->__end);  goto l62;
+  l63:;	  yy->__pos= yypos62; yy->__thunkpos= yythunkpos62;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l61;
+#undef yytext
+#undef yyleng
+  }  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\372\357\377\377\377\377\377\337\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l61;
+  l66:;	
+  {  int yypos67= yy->__pos, yythunkpos67= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\372\357\377\377\377\377\377\337\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l67;  goto l66;
+  l67:;	  yy->__pos= yypos67; yy->__thunkpos= yythunkpos67;
+  }  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l61;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_2_string, yy->__begin, yy->__end);
+  }
+  l62:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "string", yy->__buf+yy->__pos));
+  return 1;
+  l61:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "string", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_balance(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "balance"));
+  {  int yypos69= yy->__pos, yythunkpos69= yy->__thunkpos;  if (!yymatchString(yy, "roundrobin")) goto l70;  yyDo(yy, yy_1_balance, yy->__begin, yy->__end);  goto l69;
+  l70:;	  yy->__pos= yypos69; yy->__thunkpos= yythunkpos69;  if (!yymatchString(yy, "leastconn")) goto l71;  yyDo(yy, yy_2_balance, yy->__begin, yy->__end);  goto l69;
+  l71:;	  yy->__pos= yypos69; yy->__thunkpos= yythunkpos69;  if (!yymatchString(yy, "p2c")) goto l72;  yyDo(yy, yy_3_balance, yy->__begin, yy->__end);  goto l69;
+  l72:;	  yy->__pos= yypos69; yy->__thunkpos= yythunkpos69;  if (!yymatchString(yy, "hash")) goto l68;  yyDo(yy, yy_4_balance, yy->__begin, yy->__end);
+  }
+  l69:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "balance", yy->__buf+yy->__pos));
+  return 1;
+  l68:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "balance", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_number(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "number"));  if (!yy_digit(yy)) goto l73;
+  l74:;	
+  {  int yypos75= yy->__pos, yythunkpos75= yy->__thunkpos;  if (!yy_digit(yy)) goto l75;  goto l74;
+  l75:;	  yy->__pos= yypos75; yy->__thunkpos= yythunkpos75;
+  }
+  yyprintf((stderr, "  ok   %s @ %s\n", "number", yy->__buf+yy->__pos));
+  return 1;
+  l73:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "number", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_option_retries(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "option_retries"));  if (!yymatchString(yy, "retries")) goto l76;
+  {  int yypos77= yy->__pos, yythunkpos77= yy->__thunkpos;  if (!yy__(yy)) goto l77;  goto l78;
+  l77:;	  yy->__pos= yypos77; yy->__thunkpos= yythunkpos77;
+  }
+  l78:;	  if (!yymatchChar(yy, '=')) goto l76;
+  {  int yypos79= yy->__pos, yythunkpos79= yy->__thunkpos;  if (!yy__(yy)) goto l79;  goto l80;
+  l79:;	  yy->__pos= yypos79; yy->__thunkpos= yythunkpos79;
+  }
+  l80:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l76;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l76;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l76;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_retries, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_retries", yy->__buf+yy->__pos));
+  return 1;
+  l76:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_retries", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_option_connecttimeout(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "option_connecttimeout"));  if (!yymatchString(yy, "connecttimeout")) goto l81;
+  {  int yypos82= yy->__pos, yythunkpos82= yy->__thunkpos;  if (!yy__(yy)) goto l82;  goto l83;
+  l82:;	  yy->__pos= yypos82; yy->__thunkpos= yythunkpos82;
+  }
+  l83:;	  if (!yymatchChar(yy, '=')) goto l81;
+  {  int yypos84= yy->__pos, yythunkpos84= yy->__thunkpos;  if (!yy__(yy)) goto l84;  goto l85;
+  l84:;	  yy->__pos= yypos84; yy->__thunkpos= yythunkpos84;
+  }
+  l85:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l81;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l81;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l81;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_connecttimeout, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_connecttimeout", yy->__buf+yy->__pos));
   return 1;
-  l1:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "eof", yy->__buf+yy->__pos));
+  l81:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_connecttimeout", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_digit(yycontext *yy)
+YY_RULE(int) yy_option_eject(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "digit"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\377\003\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l2;
-  yyprintf((stderr, "  ok   %s @ %s\n", "digit", yy->__buf+yy->__pos));
+  yyprintf((stderr, "%s\n", "option_eject"));  if (!yymatchString(yy, "eject")) goto l86;
+  {  int yypos87= yy->__pos, yythunkpos87= yy->__thunkpos;  if (!yy__(yy)) goto l87;  goto l88;
+  l87:;	  yy->__pos= yypos87; yy->__thunkpos= yythunkpos87;
+  }
+  l88:;	  if (!yymatchChar(yy, '=')) goto l86;
+  {  int yypos89= yy->__pos, yythunkpos89= yy->__thunkpos;  if (!yy__(yy)) goto l89;  goto l90;
+  l89:;	  yy->__pos= yypos89; yy->__thunkpos= yythunkpos89;
+  }
+  l90:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l86;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l86;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l86;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_eject, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_eject", yy->__buf+yy->__pos));
   return 1;
-  l2:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "digit", yy->__buf+yy->__pos));
+  l86:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_eject", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_hostname(yycontext *yy)
+YY_RULE(int) yy_option_ejecttime(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "hostname"));
-  l4:;	
-  {  int yypos5= yy->__pos, yythunkpos5= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l5;
-  l6:;	
-  {  int yypos7= yy->__pos, yythunkpos7= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l7;  goto l6;
-  l7:;	  yy->__pos= yypos7; yy->__thunkpos= yythunkpos7;
-  }  if (!yymatchChar(yy, '.')) goto l5;  goto l4;
-  l5:;	  yy->__pos= yypos5; yy->__thunkpos= yythunkpos5;
-  }  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l3;
-  l8:;	
-  {  int yypos9= yy->__pos, yythunkpos9= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\040\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l9;  goto l8;
-  l9:;	  yy->__pos= yypos9; yy->__thunkpos= yythunkpos9;
+  yyprintf((stderr, "%s\n", "option_ejecttime"));  if (!yymatchString(yy, "ejecttime")) goto l91;
+  {  int yypos92= yy->__pos, yythunkpos92= yy->__thunkpos;  if (!yy__(yy)) goto l92;  goto l93;
+  l92:;	  yy->__pos= yypos92; yy->__thunkpos= yythunkpos92;
   }
-  {  int yypos10= yy->__pos, yythunkpos10= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l10;  goto l11;
-  l10:;	  yy->__pos= yypos10; yy->__thunkpos= yythunkpos10;
+  l93:;	  if (!yymatchChar(yy, '=')) goto l91;
+  {  int yypos94= yy->__pos, yythunkpos94= yy->__thunkpos;  if (!yy__(yy)) goto l94;  goto l95;
+  l94:;	  yy->__pos= yypos94; yy->__thunkpos= yythunkpos94;
   }
-  l11:;	
-  yyprintf((stderr, "  ok   %s @ %s\n", "hostname", yy->__buf+yy->__pos));
+  l95:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l91;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l91;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l91;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_ejecttime, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_ejecttime", yy->__buf+yy->__pos));
   return 1;
-  l3:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "hostname", yy->__buf+yy->__pos));
+  l91:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_ejecttime", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_ipv4(yycontext *yy)
+YY_RULE(int) yy_option_expect(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "ipv4"));
-  {  int yypos13= yy->__pos, yythunkpos13= yy->__thunkpos;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  if (!yymatchChar(yy, '.')) goto l14;  if (!yy_number(yy)) goto l14;  goto l13;
-  l14:;	  yy->__pos= yypos13; yy->__thunkpos= yythunkpos13;  if (!yymatchChar(yy, '0')) goto l12;
+  yyprintf((stderr, "%s\n", "option_expect"));  if (!yymatchString(yy, "expect")) goto l96;
+  {  int yypos97= yy->__pos, yythunkpos97= yy->__thunkpos;  if (!yy__(yy)) goto l97;  goto l98;
+  l97:;	  yy->__pos= yypos97; yy->__thunkpos= yythunkpos97;
   }
-  l13:;	
-  yyprintf((stderr, "  ok   %s @ %s\n", "ipv4", yy->__buf+yy->__pos));
+  l98:;	  if (!yymatchChar(yy, '=')) goto l96;
+  {  int yypos99= yy->__pos, yythunkpos99= yy->__thunkpos;  if (!yy__(yy)) goto l99;  goto l100;
+  l99:;	  yy->__pos= yypos99; yy->__thunkpos= yythunkpos99;
+  }
+  l100:;	  if (!yy_string(yy)) goto l96;  yyDo(yy, yy_1_option_expect, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_expect", yy->__buf+yy->__pos));
   return 1;
-  l12:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "ipv4", yy->__buf+yy->__pos));
+  l96:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_expect", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_name(yycontext *yy)
+YY_RULE(int) yy_option_send(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "name"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\000\000\376\377\377\007\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l15;
-  l16:;	
-  {  int yypos17= yy->__pos, yythunkpos17= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\000\377\003\376\377\377\207\376\377\377\007\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l17;  goto l16;
-  l17:;	  yy->__pos= yypos17; yy->__thunkpos= yythunkpos17;
+  yyprintf((stderr, "%s\n", "option_send"));  if (!yymatchString(yy, "send")) goto l101;
+  {  int yypos102= yy->__pos, yythunkpos102= yy->__thunkpos;  if (!yy__(yy)) goto l102;  goto l103;
+  l102:;	  yy->__pos= yypos102; yy->__thunkpos= yythunkpos102;
   }
-  yyprintf((stderr, "  ok   %s @ %s\n", "name", yy->__buf+yy->__pos));
+  l103:;	  if (!yymatchChar(yy, '=')) goto l101;
+  {  int yypos104= yy->__pos, yythunkpos104= yy->__thunkpos;  if (!yy__(yy)) goto l104;  goto l105;
+  l104:;	  yy->__pos= yypos104; yy->__thunkpos= yythunkpos104;
+  }
+  l105:;	  if (!yy_string(yy)) goto l101;  yyDo(yy, yy_1_option_send, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_send", yy->__buf+yy->__pos));
   return 1;
-  l15:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "name", yy->__buf+yy->__pos));
+  l101:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_send", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_filename(yycontext *yy)
+YY_RULE(int) yy_option_fall(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "filename"));
-  {  int yypos19= yy->__pos, yythunkpos19= yy->__thunkpos;  if (!yymatchChar(yy, '"')) goto l20;  if (!yymatchClass(yy, (unsigned char *)"\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l20;
-  l21:;	
-  {  int yypos22= yy->__pos, yythunkpos22= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\377\377\377\373\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l22;  goto l21;
-  l22:;	  yy->__pos= yypos22; yy->__thunkpos= yythunkpos22;
-  }  if (!yymatchChar(yy, '"')) goto l20;  goto l19;
-  l20:;	  yy->__pos= yypos19; yy->__thunkpos= yythunkpos19;  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l18;
-  l23:;	
-  {  int yypos24= yy->__pos, yythunkpos24= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\377\331\377\377\376\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377\377")) goto l24;  goto l23;
-  l24:;	  yy->__pos= yypos24; yy->__thunkpos= yythunkpos24;
+  yyprintf((stderr, "%s\n", "option_fall"));  if (!yymatchString(yy, "fall")) goto l106;
+  {  int yypos107= yy->__pos, yythunkpos107= yy->__thunkpos;  if (!yy__(yy)) goto l107;  goto l108;
+  l107:;	  yy->__pos= yypos107; yy->__thunkpos= yythunkpos107;
   }
+  l108:;	  if (!yymatchChar(yy, '=')) goto l106;
+  {  int yypos109= yy->__pos, yythunkpos109= yy->__thunkpos;  if (!yy__(yy)) goto l109;  goto l110;
+  l109:;	  yy->__pos= yypos109; yy->__thunkpos= yythunkpos109;
   }
-  l19:;	
-  yyprintf((stderr, "  ok   %s @ %s\n", "filename", yy->__buf+yy->__pos));
+  l110:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l106;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l106;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l106;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_fall, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_fall", yy->__buf+yy->__pos));
   return 1;
-  l18:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "filename", yy->__buf+yy->__pos));
+  l106:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_fall", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_pattern(yycontext *yy)
+YY_RULE(int) yy_option_rise(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "pattern"));  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l25;
-  l26:;	
-  {  int yypos27= yy->__pos, yythunkpos27= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l27;  goto l26;
-  l27:;	  yy->__pos= yypos27; yy->__thunkpos= yythunkpos27;
-  }
-  {  int yypos28= yy->__pos, yythunkpos28= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l28;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l28;
-  l30:;	
-  {  int yypos31= yy->__pos, yythunkpos31= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l31;  goto l30;
-  l31:;	  yy->__pos= yypos31; yy->__thunkpos= yythunkpos31;
-  }
-  {  int yypos32= yy->__pos, yythunkpos32= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l32;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l32;
-  l34:;	
-  {  int yypos35= yy->__pos, yythunkpos35= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l35;  goto l34;
-  l35:;	  yy->__pos= yypos35; yy->__thunkpos= yythunkpos35;
-  }
-  {  int yypos36= yy->__pos, yythunkpos36= yy->__thunkpos;  if (!yymatchChar(yy, '.')) goto l36;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l36;
-  l38:;	
-  {  int yypos39= yy->__pos, yythunkpos39= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\000\000\000\000\004\377\203\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l39;  goto l38;
-  l39:;	  yy->__pos= yypos39; yy->__thunkpos= yythunkpos39;
-  }  goto l37;
-  l36:;	  yy->__pos= yypos36; yy->__thunkpos= yythunkpos36;
-  }
-  l37:;	  goto l33;
-  l32:;	  yy->__pos= yypos32; yy->__thunkpos= yythunkpos32;
+  yyprintf((stderr, "%s\n", "option_rise"));  if (!yymatchString(yy, "rise")) goto l111;
+  {  int yypos112= yy->__pos, yythunkpos112= yy->__thunkpos;  if (!yy__(yy)) goto l112;  goto l113;
+  l112:;	  yy->__pos= yypos112; yy->__thunkpos= yythunkpos112;
   }
-  l33:;	  goto l29;
-  l28:;	  yy->__pos= yypos28; yy->__thunkpos= yythunkpos28;
+  l113:;	  if (!yymatchChar(yy, '=')) goto l111;
+  {  int yypos114= yy->__pos, yythunkpos114= yy->__thunkpos;  if (!yy__(yy)) goto l114;  goto l115;
+  l114:;	  yy->__pos= yypos114; yy->__thunkpos= yythunkpos114;
   }
-  l29:;	
-  yyprintf((stderr, "  ok   %s @ %s\n", "pattern", yy->__buf+yy->__pos));
+  l115:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l111;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l111;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l111;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_rise, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_rise", yy->__buf+yy->__pos));
   return 1;
-  l25:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "pattern", yy->__buf+yy->__pos));
+  l111:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_rise", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_auth_key(yycontext *yy)
+YY_RULE(int) yy_option_check(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "auth_key"));  yyText(yy, yy->__begin, yy->__end);  {
+  yyprintf((stderr, "%s\n", "option_check"));  if (!yymatchString(yy, "check")) goto l116;
+  {  int yypos117= yy->__pos, yythunkpos117= yy->__thunkpos;  if (!yy__(yy)) goto l117;  goto l118;
+  l117:;	  yy->__pos= yypos117; yy->__thunkpos= yythunkpos117;
+  }
+  l118:;	  if (!yymatchChar(yy, '=')) goto l116;
+  {  int yypos119= yy->__pos, yythunkpos119= yy->__thunkpos;  if (!yy__(yy)) goto l119;  goto l120;
+  l119:;	  yy->__pos= yypos119; yy->__thunkpos= yythunkpos119;
+  }
+  l120:;	  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l40;
+if (!(YY_BEGIN)) goto l116;
 #undef yytext
 #undef yyleng
-  }
-  {  int yypos41= yy->__pos, yythunkpos41= yy->__thunkpos;  if (!yymatchString(yy, "allow")) goto l42;  goto l41;
-  l42:;	  yy->__pos= yypos41; yy->__thunkpos= yythunkpos41;  if (!yymatchString(yy, "deny")) goto l40;
-  }
-  l41:;	  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_number(yy)) goto l116;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l40;
+if (!(YY_END)) goto l116;
 #undef yytext
 #undef yyleng
-  }  yyDo(yy, yy_1_auth_key, yy->__begin, yy->__end);
-  yyprintf((stderr, "  ok   %s @ %s\n", "auth_key", yy->__buf+yy->__pos));
+  }  yyDo(yy, yy_1_option_check, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_check", yy->__buf+yy->__pos));
   return 1;
-  l40:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "auth_key", yy->__buf+yy->__pos));
+  l116:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_check", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_service(yycontext *yy)
+YY_RULE(int) yy_option_balance(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "service"));  if (!yy_name(yy)) goto l43;
-  yyprintf((stderr, "  ok   %s @ %s\n", "service", yy->__buf+yy->__pos));
+  yyprintf((stderr, "%s\n", "option_balance"));  if (!yymatchString(yy, "balance")) goto l121;
+  {  int yypos122= yy->__pos, yythunkpos122= yy->__thunkpos;  if (!yy__(yy)) goto l122;  goto l123;
+  l122:;	  yy->__pos= yypos122; yy->__thunkpos= yythunkpos122;
+  }
+  l123:;	  if (!yymatchChar(yy, '=')) goto l121;
+  {  int yypos124= yy->__pos, yythunkpos124= yy->__thunkpos;  if (!yy__(yy)) goto l124;  goto l125;
+  l124:;	  yy->__pos= yypos124; yy->__thunkpos= yythunkpos124;
+  }
+  l125:;	  if (!yy_balance(yy)) goto l121;
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_balance", yy->__buf+yy->__pos));
   return 1;
-  l43:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "service", yy->__buf+yy->__pos));
+  l121:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_balance", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_proto(yycontext *yy)
+YY_RULE(int) yy_option_maxbuf(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "proto"));
-  {  int yypos45= yy->__pos, yythunkpos45= yy->__thunkpos;  if (!yymatchString(yy, "/tcp")) goto l46;  yyDo(yy, yy_1_proto, yy->__begin, yy->__end);  goto l45;
-  l46:;	  yy->__pos= yypos45; yy->__thunkpos= yythunkpos45;  if (!yymatchString(yy, "/udp")) goto l47;  yyDo(yy, yy_2_proto, yy->__begin, yy->__end);  goto l45;
-  l47:;	  yy->__pos= yypos45; yy->__thunkpos= yythunkpos45;  if (!yymatchString(yy, "")) goto l44;  yyDo(yy, yy_3_proto, yy->__begin, yy->__end);
+  yyprintf((stderr, "%s\n", "option_maxbuf"));  if (!yymatchString(yy, "maxbuf")) goto l126;
+  {  int yypos127= yy->__pos, yythunkpos127= yy->__thunkpos;  if (!yy__(yy)) goto l127;  goto l128;
+  l127:;	  yy->__pos= yypos127; yy->__thunkpos= yythunkpos127;
   }
-  l45:;	
-  yyprintf((stderr, "  ok   %s @ %s\n", "proto", yy->__buf+yy->__pos));
+  l128:;	  if (!yymatchChar(yy, '=')) goto l126;
+  {  int yypos129= yy->__pos, yythunkpos129= yy->__thunkpos;  if (!yy__(yy)) goto l129;  goto l130;
+  l129:;	  yy->__pos= yypos129; yy->__thunkpos= yythunkpos129;
+  }
+  l130:;	  if (!yy_size(yy)) goto l126;  yyDo(yy, yy_1_option_maxbuf, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_maxbuf", yy->__buf+yy->__pos));
   return 1;
-  l44:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "proto", yy->__buf+yy->__pos));
+  l126:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_maxbuf", yy->__buf+yy->__pos));
   return 0;
 }
-YY_RULE(int) yy_port(yycontext *yy)
+YY_RULE(int) yy_option_minbuf(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "port"));  yyText(yy, yy->__begin, yy->__end);  {
+  yyprintf((stderr, "%s\n", "option_minbuf"));  if (!yymatchString(yy, "minbuf")) goto l131;
+  {  int yypos132= yy->__pos, yythunkpos132= yy->__thunkpos;  if (!yy__(yy)) goto l132;  goto l133;
+  l132:;	  yy->__pos= yypos132; yy->__thunkpos= yythunkpos132;
+  }
+  l133:;	  if (!yymatchChar(yy, '=')) goto l131;
+  {  int yypos134= yy->__pos, yythunkpos134= yy->__thunkpos;  if (!yy__(yy)) goto l134;  goto l135;
+  l134:;	  yy->__pos= yypos134; yy->__thunkpos= yythunkpos134;
+  }
+  l135:;	  if (!yy_size(yy)) goto l131;  yyDo(yy, yy_1_option_minbuf, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_minbuf", yy->__buf+yy->__pos));
+  return 1;
+  l131:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_minbuf", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_option_batch(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "option_batch"));  if (!yymatchString(yy, "batch")) goto l136;
+  {  int yypos137= yy->__pos, yythunkpos137= yy->__thunkpos;  if (!yy__(yy)) goto l137;  goto l138;
+  l137:;	  yy->__pos= yypos137; yy->__thunkpos= yythunkpos137;
+  }
+  l138:;	  if (!yymatchChar(yy, '=')) goto l136;
+  {  int yypos139= yy->__pos, yythunkpos139= yy->__thunkpos;  if (!yy__(yy)) goto l139;  goto l140;
+  l139:;	  yy->__pos= yypos139; yy->__thunkpos= yythunkpos139;
+  }
+  l140:;	  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l48;
+if (!(YY_BEGIN)) goto l136;
 #undef yytext
 #undef yyleng
-  }
-  {  int yypos49= yy->__pos, yythunkpos49= yy->__thunkpos;  if (!yy_number(yy)) goto l50;  goto l49;
-  l50:;	  yy->__pos= yypos49; yy->__thunkpos= yythunkpos49;  if (!yy_service(yy)) goto l48;
-  }
-  l49:;	  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_number(yy)) goto l136;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l48;
+if (!(YY_END)) goto l136;
 #undef yytext
 #undef yyleng
-  }  yyDo(yy, yy_1_port, yy->__begin, yy->__end);
-  yyprintf((stderr, "  ok   %s @ %s\n", "port", yy->__buf+yy->__pos));
-  return 1;
-  l48:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "port", yy->__buf+yy->__pos));
-  return 0;
-}
-YY_RULE(int) yy_number(yycontext *yy)
-{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "number"));  if (!yy_digit(yy)) goto l51;
-  l52:;	
-  {  int yypos53= yy->__pos, yythunkpos53= yy->__thunkpos;  if (!yy_digit(yy)) goto l53;  goto l52;
-  l53:;	  yy->__pos= yypos53; yy->__thunkpos= yythunkpos53;
-  }
-  yyprintf((stderr, "  ok   %s @ %s\n", "number", yy->__buf+yy->__pos));
+  }  yyDo(yy, yy_1_option_batch, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_batch", yy->__buf+yy->__pos));
   return 1;
-  l51:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
-  yyprintf((stderr, "  fail %s @ %s\n", "number", yy->__buf+yy->__pos));
+  l136:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_batch", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_option_source(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "option_source"));  if (!yymatchString(yy, "src")) goto l54;
-  {  int yypos55= yy->__pos, yythunkpos55= yy->__thunkpos;  if (!yy__(yy)) goto l55;  goto l56;
-  l55:;	  yy->__pos= yypos55; yy->__thunkpos= yythunkpos55;
+  yyprintf((stderr, "%s\n", "option_source"));  if (!yymatchString(yy, "src")) goto l141;
+  {  int yypos142= yy->__pos, yythunkpos142= yy->__thunkpos;  if (!yy__(yy)) goto l142;  goto l143;
+  l142:;	  yy->__pos= yypos142; yy->__thunkpos= yythunkpos142;
   }
-  l56:;	  if (!yymatchChar(yy, '=')) goto l54;
-  {  int yypos57= yy->__pos, yythunkpos57= yy->__thunkpos;  if (!yy__(yy)) goto l57;  goto l58;
-  l57:;	  yy->__pos= yypos57; yy->__thunkpos= yythunkpos57;
+  l143:;	  if (!yymatchChar(yy, '=')) goto l141;
+  {  int yypos144= yy->__pos, yythunkpos144= yy->__thunkpos;  if (!yy__(yy)) goto l144;  goto l145;
+  l144:;	  yy->__pos= yypos144; yy->__thunkpos= yythunkpos144;
   }
-  l58:;	  yyText(yy, yy->__begin, yy->__end);  {
+  l145:;	  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l54;
+if (!(YY_BEGIN)) goto l141;
 #undef yytext
 #undef yyleng
-  }  if (!yy_address(yy)) goto l54;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_address(yy)) goto l141;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l54;
+if (!(YY_END)) goto l141;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_option_source, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "option_source", yy->__buf+yy->__pos));
   return 1;
-  l54:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l141:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "option_source", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_option_timeout(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "option_timeout"));  if (!yymatchString(yy, "timeout")) goto l59;
-  {  int yypos60= yy->__pos, yythunkpos60= yy->__thunkpos;  if (!yy__(yy)) goto l60;  goto l61;
-  l60:;	  yy->__pos= yypos60; yy->__thunkpos= yythunkpos60;
+  yyprintf((stderr, "%s\n", "option_timeout"));  if (!yymatchString(yy, "timeout")) goto l146;
+  {  int yypos147= yy->__pos, yythunkpos147= yy->__thunkpos;  if (!yy__(yy)) goto l147;  goto l148;
+  l147:;	  yy->__pos= yypos147; yy->__thunkpos= yythunkpos147;
   }
-  l61:;	  if (!yymatchChar(yy, '=')) goto l59;
-  {  int yypos62= yy->__pos, yythunkpos62= yy->__thunkpos;  if (!yy__(yy)) goto l62;  goto l63;
-  l62:;	  yy->__pos= yypos62; yy->__thunkpos= yythunkpos62;
+  l148:;	  if (!yymatchChar(yy, '=')) goto l146;
+  {  int yypos149= yy->__pos, yythunkpos149= yy->__thunkpos;  if (!yy__(yy)) goto l149;  goto l150;
+  l149:;	  yy->__pos= yypos149; yy->__thunkpos= yythunkpos149;
   }
-  l63:;	  yyText(yy, yy->__begin, yy->__end);  {
+  l150:;	  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l59;
+if (!(YY_BEGIN)) goto l146;
 #undef yytext
 #undef yyleng
-  }  if (!yy_number(yy)) goto l59;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_number(yy)) goto l146;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l59;
+if (!(YY_END)) goto l146;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_option_timeout, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "option_timeout", yy->__buf+yy->__pos));
   return 1;
-  l59:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l146:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "option_timeout", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_option(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
   yyprintf((stderr, "%s\n", "option"));
-  {  int yypos65= yy->__pos, yythunkpos65= yy->__thunkpos;  if (!yy_option_timeout(yy)) goto l66;  goto l65;
-  l66:;	  yy->__pos= yypos65; yy->__thunkpos= yythunkpos65;  if (!yy_option_source(yy)) goto l64;
-  }
-  l65:;	
+  {  int yypos152= yy->__pos, yythunkpos152= yy->__thunkpos;  if (!yy_option_timeout(yy)) goto l153;  goto l152;
+  l153:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_source(yy)) goto l154;  goto l152;
+  l154:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_batch(yy)) goto l155;  goto l152;
+  l155:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_minbuf(yy)) goto l156;  goto l152;
+  l156:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_maxbuf(yy)) goto l157;  goto l152;
+  l157:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_balance(yy)) goto l158;  goto l152;
+  l158:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_weight(yy)) goto l159;  goto l152;
+  l159:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_check(yy)) goto l160;  goto l152;
+  l160:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_rise(yy)) goto l161;  goto l152;
+  l161:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_fall(yy)) goto l162;  goto l152;
+  l162:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_send(yy)) goto l163;  goto l152;
+  l163:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_expect(yy)) goto l164;  goto l152;
+  l164:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_ejecttime(yy)) goto l165;  goto l152;
+  l165:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_eject(yy)) goto l166;  goto l152;
+  l166:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_connecttimeout(yy)) goto l167;  goto l152;
+  l167:;	  yy->__pos= yypos152; yy->__thunkpos= yythunkpos152;  if (!yy_option_retries(yy)) goto l151;
+  }
+  l152:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "option", yy->__buf+yy->__pos));
   return 1;
-  l64:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l151:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "option", yy->__buf+yy->__pos));
   return 0;
 }
+YY_RULE(int) yy_option_weight(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "option_weight"));  if (!yymatchString(yy, "weight")) goto l168;
+  {  int yypos169= yy->__pos, yythunkpos169= yy->__thunkpos;  if (!yy__(yy)) goto l169;  goto l170;
+  l169:;	  yy->__pos= yypos169; yy->__thunkpos= yythunkpos169;
+  }
+  l170:;	  if (!yymatchChar(yy, '=')) goto l168;
+  {  int yypos171= yy->__pos, yythunkpos171= yy->__thunkpos;  if (!yy__(yy)) goto l171;  goto l172;
+  l171:;	  yy->__pos= yypos171; yy->__thunkpos= yythunkpos171;
+  }
+  l172:;	  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l168;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l168;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l168;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_option_weight, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "option_weight", yy->__buf+yy->__pos));
+  return 1;
+  l168:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "option_weight", yy->__buf+yy->__pos));
+  return 0;
+}
 YY_RULE(int) yy_option_list(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "option_list"));  if (!yy_option(yy)) goto l67;
-  {  int yypos68= yy->__pos, yythunkpos68= yy->__thunkpos;
-  {  int yypos70= yy->__pos, yythunkpos70= yy->__thunkpos;  if (!yy__(yy)) goto l70;  goto l71;
-  l70:;	  yy->__pos= yypos70; yy->__thunkpos= yythunkpos70;
+  yyprintf((stderr, "%s\n", "option_list"));  if (!yy_option(yy)) goto l173;
+  {  int yypos174= yy->__pos, yythunkpos174= yy->__thunkpos;
+  {  int yypos176= yy->__pos, yythunkpos176= yy->__thunkpos;  if (!yy__(yy)) goto l176;  goto l177;
+  l176:;	  yy->__pos= yypos176; yy->__thunkpos= yythunkpos176;
   }
-  l71:;	  if (!yymatchChar(yy, ',')) goto l68;
-  {  int yypos72= yy->__pos, yythunkpos72= yy->__thunkpos;  if (!yy__(yy)) goto l72;  goto l73;
-  l72:;	  yy->__pos= yypos72; yy->__thunkpos= yythunkpos72;
+  l177:;	  if (!yymatchChar(yy, ',')) goto l174;
+  {  int yypos178= yy->__pos, yythunkpos178= yy->__thunkpos;  if (!yy__(yy)) goto l178;  goto l179;
+  l178:;	  yy->__pos= yypos178; yy->__thunkpos= yythunkpos178;
   }
-  l73:;	  if (!yy_option_list(yy)) goto l68;  goto l69;
-  l68:;	  yy->__pos= yypos68; yy->__thunkpos= yythunkpos68;
+  l179:;	  if (!yy_option_list(yy)) goto l174;  goto l175;
+  l174:;	  yy->__pos= yypos174; yy->__thunkpos= yythunkpos174;
   }
-  l69:;	
+  l175:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "option_list", yy->__buf+yy->__pos));
   return 1;
-  l67:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l173:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "option_list", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_full_port(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "full_port"));  if (!yy_port(yy)) goto l74;  if (!yy_proto(yy)) goto l74;  yyDo(yy, yy_1_full_port, yy->__begin, yy->__end);
+  yyprintf((stderr, "%s\n", "full_port"));  if (!yy_port(yy)) goto l180;  if (!yy_proto(yy)) goto l180;  yyDo(yy, yy_1_full_port, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "full_port", yy->__buf+yy->__pos));
   return 1;
-  l74:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l180:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "full_port", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_address(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
   yyprintf((stderr, "%s\n", "address"));
-  {  int yypos76= yy->__pos, yythunkpos76= yy->__thunkpos;  if (!yy_ipv4(yy)) goto l77;  goto l76;
-  l77:;	  yy->__pos= yypos76; yy->__thunkpos= yythunkpos76;  if (!yy_hostname(yy)) goto l75;
+  {  int yypos182= yy->__pos, yythunkpos182= yy->__thunkpos;  if (!yy_ipv4(yy)) goto l183;  goto l182;
+  l183:;	  yy->__pos= yypos182; yy->__thunkpos= yythunkpos182;  if (!yy_hostname(yy)) goto l181;
   }
-  l76:;	
+  l182:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "address", yy->__buf+yy->__pos));
   return 1;
-  l75:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l181:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "address", yy->__buf+yy->__pos));
   return 0;
 }
+YY_RULE(int) yy_backend_options(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "backend_options"));  if (!yymatchChar(yy, '[')) goto l184;
+  {  int yypos185= yy->__pos, yythunkpos185= yy->__thunkpos;  if (!yy__(yy)) goto l185;  goto l186;
+  l185:;	  yy->__pos= yypos185; yy->__thunkpos= yythunkpos185;
+  }
+  l186:;	  if (!yy_option_weight(yy)) goto l184;
+  {  int yypos187= yy->__pos, yythunkpos187= yy->__thunkpos;  if (!yy__(yy)) goto l187;  goto l188;
+  l187:;	  yy->__pos= yypos187; yy->__thunkpos= yythunkpos187;
+  }
+  l188:;	  if (!yymatchChar(yy, ']')) goto l184;
+  yyprintf((stderr, "  ok   %s @ %s\n", "backend_options", yy->__buf+yy->__pos));
+  return 1;
+  l184:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "backend_options", yy->__buf+yy->__pos));
+  return 0;
+}
 YY_RULE(int) yy_server_options(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "server_options"));  if (!yymatchChar(yy, '[')) goto l78;
-  {  int yypos79= yy->__pos, yythunkpos79= yy->__thunkpos;  if (!yy__(yy)) goto l79;  goto l80;
-  l79:;	  yy->__pos= yypos79; yy->__thunkpos= yythunkpos79;
+  yyprintf((stderr, "%s\n", "server_options"));  if (!yymatchChar(yy, '[')) goto l189;
+  {  int yypos190= yy->__pos, yythunkpos190= yy->__thunkpos;  if (!yy__(yy)) goto l190;  goto l191;
+  l190:;	  yy->__pos= yypos190; yy->__thunkpos= yythunkpos190;
   }
-  l80:;	  if (!yy_option_list(yy)) goto l78;
-  {  int yypos81= yy->__pos, yythunkpos81= yy->__thunkpos;  if (!yy__(yy)) goto l81;  goto l82;
-  l81:;	  yy->__pos= yypos81; yy->__thunkpos= yythunkpos81;
+  l191:;	  if (!yy_option_list(yy)) goto l189;
+  {  int yypos192= yy->__pos, yythunkpos192= yy->__thunkpos;  if (!yy__(yy)) goto l192;  goto l193;
+  l192:;	  yy->__pos= yypos192; yy->__thunkpos= yythunkpos192;
   }
-  l82:;	  if (!yymatchChar(yy, ']')) goto l78;
+  l193:;	  if (!yymatchChar(yy, ']')) goto l189;
   yyprintf((stderr, "  ok   %s @ %s\n", "server_options", yy->__buf+yy->__pos));
   return 1;
-  l78:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l189:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "server_options", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_connect_port(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "connect_port"));  if (!yy_full_port(yy)) goto l83;  yyDo(yy, yy_1_connect_port, yy->__begin, yy->__end);
+  yyprintf((stderr, "%s\n", "connect_port"));  if (!yy_full_port(yy)) goto l194;  yyDo(yy, yy_1_connect_port, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "connect_port", yy->__buf+yy->__pos));
   return 1;
-  l83:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l194:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "connect_port", yy->__buf+yy->__pos));
   return 0;
 }
@@ -1022,28 +2190,28 @@ YY_RULE(int) yy_connect_address(yycontext *yy)
   yyprintf((stderr, "%s\n", "connect_address"));  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l84;
+if (!(YY_BEGIN)) goto l195;
 #undef yytext
 #undef yyleng
-  }  if (!yy_address(yy)) goto l84;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_address(yy)) goto l195;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l84;
+if (!(YY_END)) goto l195;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_connect_address, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "connect_address", yy->__buf+yy->__pos));
   return 1;
-  l84:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l195:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "connect_address", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_bind_port(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "bind_port"));  if (!yy_full_port(yy)) goto l85;  yyDo(yy, yy_1_bind_port, yy->__begin, yy->__end);
+  yyprintf((stderr, "%s\n", "bind_port"));  if (!yy_full_port(yy)) goto l196;  yyDo(yy, yy_1_bind_port, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "bind_port", yy->__buf+yy->__pos));
   return 1;
-  l85:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l196:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "bind_port", yy->__buf+yy->__pos));
   return 0;
 }
@@ -1052,153 +2220,275 @@ YY_RULE(int) yy_bind_address(yycontext *yy)
   yyprintf((stderr, "%s\n", "bind_address"));  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l86;
+if (!(YY_BEGIN)) goto l197;
 #undef yytext
 #undef yyleng
-  }  if (!yy_address(yy)) goto l86;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_address(yy)) goto l197;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l86;
+if (!(YY_END)) goto l197;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_bind_address, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "bind_address", yy->__buf+yy->__pos));
   return 1;
-  l86:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l197:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "bind_address", yy->__buf+yy->__pos));
   return 0;
 }
+YY_RULE(int) yy_workers(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "workers"));  if (!yymatchString(yy, "workers")) goto l198;  if (!yy__(yy)) goto l198;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l198;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l198;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l198;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_workers, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "workers", yy->__buf+yy->__pos));
+  return 1;
+  l198:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "workers", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_flightrecorder(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "flightrecorder"));  if (!yymatchString(yy, "flightrecorder")) goto l199;  if (!yy__(yy)) goto l199;  if (!yy_flight_latency(yy)) goto l199;
+  {  int yypos200= yy->__pos, yythunkpos200= yy->__thunkpos;  if (!yy__(yy)) goto l200;  if (!yy_flight_duration(yy)) goto l200;  goto l201;
+  l200:;	  yy->__pos= yypos200; yy->__thunkpos= yythunkpos200;
+  }
+  l201:;	  yyDo(yy, yy_1_flightrecorder, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "flightrecorder", yy->__buf+yy->__pos));
+  return 1;
+  l199:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "flightrecorder", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_watchdog(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "watchdog"));  if (!yymatchString(yy, "watchdog")) goto l202;  if (!yy__(yy)) goto l202;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l202;
+#undef yytext
+#undef yyleng
+  }  if (!yy_number(yy)) goto l202;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l202;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_watchdog, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "watchdog", yy->__buf+yy->__pos));
+  return 1;
+  l202:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "watchdog", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_statsfile(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "statsfile"));  if (!yymatchString(yy, "statsfile")) goto l203;  if (!yy__(yy)) goto l203;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_BEGIN)) goto l203;
+#undef yytext
+#undef yyleng
+  }  if (!yy_filename(yy)) goto l203;  yyText(yy, yy->__begin, yy->__end);  {
+#define yytext yy->__text
+#define yyleng yy->__textlen
+if (!(YY_END)) goto l203;
+#undef yytext
+#undef yyleng
+  }  yyDo(yy, yy_1_statsfile, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "statsfile", yy->__buf+yy->__pos));
+  return 1;
+  l203:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "statsfile", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_stats(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "stats"));  if (!yymatchString(yy, "stats")) goto l204;  if (!yy__(yy)) goto l204;  if (!yy_bind_address(yy)) goto l204;  if (!yy__(yy)) goto l204;  if (!yy_full_port(yy)) goto l204;  yyDo(yy, yy_1_stats, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "stats", yy->__buf+yy->__pos));
+  return 1;
+  l204:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "stats", yy->__buf+yy->__pos));
+  return 0;
+}
+YY_RULE(int) yy_logformat(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "logformat"));  if (!yymatchString(yy, "logformat")) goto l205;  if (!yy__(yy)) goto l205;  if (!yy_log_format(yy)) goto l205;
+  {  int yypos206= yy->__pos, yythunkpos206= yy->__thunkpos;  if (!yy__(yy)) goto l206;  if (!yymatchString(yy, "close-only")) goto l206;  yyDo(yy, yy_1_logformat, yy->__begin, yy->__end);  goto l207;
+  l206:;	  yy->__pos= yypos206; yy->__thunkpos= yythunkpos206;
+  }
+  l207:;	
+  yyprintf((stderr, "  ok   %s @ %s\n", "logformat", yy->__buf+yy->__pos));
+  return 1;
+  l205:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "logformat", yy->__buf+yy->__pos));
+  return 0;
+}
 YY_RULE(int) yy_logcommon(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "logcommon"));  if (!yymatchString(yy, "logcommon")) goto l87;  yyDo(yy, yy_1_logcommon, yy->__begin, yy->__end);
+  yyprintf((stderr, "%s\n", "logcommon"));  if (!yymatchString(yy, "logcommon")) goto l208;  yyDo(yy, yy_1_logcommon, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "logcommon", yy->__buf+yy->__pos));
   return 1;
-  l87:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l208:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "logcommon", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_pidlogfile(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "pidlogfile"));  if (!yymatchString(yy, "pidlogfile")) goto l88;  if (!yy__(yy)) goto l88;  yyText(yy, yy->__begin, yy->__end);  {
+  yyprintf((stderr, "%s\n", "pidlogfile"));  if (!yymatchString(yy, "pidlogfile")) goto l209;  if (!yy__(yy)) goto l209;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l88;
+if (!(YY_BEGIN)) goto l209;
 #undef yytext
 #undef yyleng
-  }  if (!yy_filename(yy)) goto l88;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_filename(yy)) goto l209;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l88;
+if (!(YY_END)) goto l209;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_pidlogfile, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "pidlogfile", yy->__buf+yy->__pos));
   return 1;
-  l88:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l209:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "pidlogfile", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_logfile(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "logfile"));  if (!yymatchString(yy, "logfile")) goto l89;  if (!yy__(yy)) goto l89;  yyText(yy, yy->__begin, yy->__end);  {
+  yyprintf((stderr, "%s\n", "logfile"));  if (!yymatchString(yy, "logfile")) goto l210;  if (!yy__(yy)) goto l210;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l89;
+if (!(YY_BEGIN)) goto l210;
 #undef yytext
 #undef yyleng
-  }  if (!yy_filename(yy)) goto l89;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_filename(yy)) goto l210;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l89;
+if (!(YY_END)) goto l210;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_logfile, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "logfile", yy->__buf+yy->__pos));
   return 1;
-  l89:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l210:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "logfile", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_auth_rule(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "auth_rule"));  if (!yy_auth_key(yy)) goto l90;  if (!yy__(yy)) goto l90;  yyText(yy, yy->__begin, yy->__end);  {
+  yyprintf((stderr, "%s\n", "auth_rule"));  if (!yy_auth_key(yy)) goto l211;  if (!yy__(yy)) goto l211;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l90;
+if (!(YY_BEGIN)) goto l211;
 #undef yytext
 #undef yyleng
-  }  if (!yy_pattern(yy)) goto l90;  yyText(yy, yy->__begin, yy->__end);  {
+  }  if (!yy_pattern(yy)) goto l211;  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l90;
+if (!(YY_END)) goto l211;
 #undef yytext
 #undef yyleng
   }  yyDo(yy, yy_1_auth_rule, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "auth_rule", yy->__buf+yy->__pos));
   return 1;
-  l90:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l211:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "auth_rule", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_server_rule(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "server_rule"));  if (!yy_bind_address(yy)) goto l91;  if (!yy__(yy)) goto l91;  if (!yy_bind_port(yy)) goto l91;  if (!yy__(yy)) goto l91;  if (!yy_connect_address(yy)) goto l91;  if (!yy__(yy)) goto l91;  if (!yy_connect_port(yy)) goto l91;
-  {  int yypos92= yy->__pos, yythunkpos92= yy->__thunkpos;
-  {  int yypos94= yy->__pos, yythunkpos94= yy->__thunkpos;  if (!yy__(yy)) goto l94;  goto l95;
-  l94:;	  yy->__pos= yypos94; yy->__thunkpos= yythunkpos94;
+  yyprintf((stderr, "%s\n", "server_rule"));  if (!yy_bind_address(yy)) goto l212;  if (!yy__(yy)) goto l212;  if (!yy_bind_port(yy)) goto l212;  if (!yy__(yy)) goto l212;  if (!yy_connect_address(yy)) goto l212;  if (!yy__(yy)) goto l212;  if (!yy_connect_port(yy)) goto l212;
+  {  int yypos213= yy->__pos, yythunkpos213= yy->__thunkpos;
+  {  int yypos215= yy->__pos, yythunkpos215= yy->__thunkpos;  if (!yy__(yy)) goto l215;  goto l216;
+  l215:;	  yy->__pos= yypos215; yy->__thunkpos= yythunkpos215;
   }
-  l95:;	  if (!yy_server_options(yy)) goto l92;  goto l93;
-  l92:;	  yy->__pos= yypos92; yy->__thunkpos= yythunkpos92;
+  l216:;	  if (!yy_server_options(yy)) goto l213;  goto l214;
+  l213:;	  yy->__pos= yypos213; yy->__thunkpos= yythunkpos213;
   }
-  l93:;	  yyDo(yy, yy_1_server_rule, yy->__begin, yy->__end);
+  l214:;	  yyDo(yy, yy_1_server_rule, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "server_rule", yy->__buf+yy->__pos));
   return 1;
-  l91:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l212:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "server_rule", yy->__buf+yy->__pos));
   return 0;
 }
+YY_RULE(int) yy_backend(yycontext *yy)
+{  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
+  yyprintf((stderr, "%s\n", "backend"));  if (!yymatchString(yy, "backend")) goto l217;  if (!yy__(yy)) goto l217;  if (!yy_connect_address(yy)) goto l217;  if (!yy__(yy)) goto l217;  if (!yy_connect_port(yy)) goto l217;
+  {  int yypos218= yy->__pos, yythunkpos218= yy->__thunkpos;
+  {  int yypos220= yy->__pos, yythunkpos220= yy->__thunkpos;  if (!yy__(yy)) goto l220;  goto l221;
+  l220:;	  yy->__pos= yypos220; yy->__thunkpos= yythunkpos220;
+  }
+  l221:;	  if (!yy_backend_options(yy)) goto l218;  goto l219;
+  l218:;	  yy->__pos= yypos218; yy->__thunkpos= yythunkpos218;
+  }
+  l219:;	  yyDo(yy, yy_1_backend, yy->__begin, yy->__end);
+  yyprintf((stderr, "  ok   %s @ %s\n", "backend", yy->__buf+yy->__pos));
+  return 1;
+  l217:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  yyprintf((stderr, "  fail %s @ %s\n", "backend", yy->__buf+yy->__pos));
+  return 0;
+}
 YY_RULE(int) yy_comment(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "comment"));  if (!yymatchChar(yy, '#')) goto l96;
-  l97:;	
-  {  int yypos98= yy->__pos, yythunkpos98= yy->__thunkpos;
-  {  int yypos99= yy->__pos, yythunkpos99= yy->__thunkpos;  if (!yy_eol(yy)) goto l99;  goto l98;
-  l99:;	  yy->__pos= yypos99; yy->__thunkpos= yythunkpos99;
-  }  if (!yymatchDot(yy)) goto l98;  goto l97;
-  l98:;	  yy->__pos= yypos98; yy->__thunkpos= yythunkpos98;
+  yyprintf((stderr, "%s\n", "comment"));  if (!yymatchChar(yy, '#')) goto l222;
+  l223:;	
+  {  int yypos224= yy->__pos, yythunkpos224= yy->__thunkpos;
+  {  int yypos225= yy->__pos, yythunkpos225= yy->__thunkpos;  if (!yy_eol(yy)) goto l225;  goto l224;
+  l225:;	  yy->__pos= yypos225; yy->__thunkpos= yythunkpos225;
+  }  if (!yymatchDot(yy)) goto l224;  goto l223;
+  l224:;	  yy->__pos= yypos224; yy->__thunkpos= yythunkpos224;
   }
   yyprintf((stderr, "  ok   %s @ %s\n", "comment", yy->__buf+yy->__pos));
   return 1;
-  l96:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l222:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "comment", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_command(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
   yyprintf((stderr, "%s\n", "command"));
-  {  int yypos101= yy->__pos, yythunkpos101= yy->__thunkpos;  if (!yy_server_rule(yy)) goto l102;  goto l101;
-  l102:;	  yy->__pos= yypos101; yy->__thunkpos= yythunkpos101;  if (!yy_auth_rule(yy)) goto l103;  goto l101;
-  l103:;	  yy->__pos= yypos101; yy->__thunkpos= yythunkpos101;  if (!yy_logfile(yy)) goto l104;  goto l101;
-  l104:;	  yy->__pos= yypos101; yy->__thunkpos= yythunkpos101;  if (!yy_pidlogfile(yy)) goto l105;  goto l101;
-  l105:;	  yy->__pos= yypos101; yy->__thunkpos= yythunkpos101;  if (!yy_logcommon(yy)) goto l100;
-  }
-  l101:;	
+  {  int yypos227= yy->__pos, yythunkpos227= yy->__thunkpos;  if (!yy_backend(yy)) goto l228;  goto l227;
+  l228:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_server_rule(yy)) goto l229;  goto l227;
+  l229:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_auth_rule(yy)) goto l230;  goto l227;
+  l230:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_logfile(yy)) goto l231;  goto l227;
+  l231:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_pidlogfile(yy)) goto l232;  goto l227;
+  l232:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_logcommon(yy)) goto l233;  goto l227;
+  l233:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_logformat(yy)) goto l234;  goto l227;
+  l234:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_stats(yy)) goto l235;  goto l227;
+  l235:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_statsfile(yy)) goto l236;  goto l227;
+  l236:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_watchdog(yy)) goto l237;  goto l227;
+  l237:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_flightrecorder(yy)) goto l238;  goto l227;
+  l238:;	  yy->__pos= yypos227; yy->__thunkpos= yythunkpos227;  if (!yy_workers(yy)) goto l226;
+  }
+  l227:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "command", yy->__buf+yy->__pos));
   return 1;
-  l100:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l226:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "command", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy__(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
-  yyprintf((stderr, "%s\n", "_"));  if (!yymatchClass(yy, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l106;
-  l107:;	
-  {  int yypos108= yy->__pos, yythunkpos108= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l108;  goto l107;
-  l108:;	  yy->__pos= yypos108; yy->__thunkpos= yythunkpos108;
+  yyprintf((stderr, "%s\n", "_"));  if (!yymatchClass(yy, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l239;
+  l240:;	
+  {  int yypos241= yy->__pos, yythunkpos241= yy->__thunkpos;  if (!yymatchClass(yy, (unsigned char *)"\000\002\000\000\001\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000\000")) goto l241;  goto l240;
+  l241:;	  yy->__pos= yypos241; yy->__thunkpos= yythunkpos241;
   }
   yyprintf((stderr, "  ok   %s @ %s\n", "_", yy->__buf+yy->__pos));
   return 1;
-  l106:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l239:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "_", yy->__buf+yy->__pos));
   return 0;
 }
@@ -1207,71 +2497,71 @@ YY_RULE(int) yy_invalid_syntax(yycontext *yy)
   yyprintf((stderr, "%s\n", "invalid_syntax"));  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_BEGIN)) goto l109;
+if (!(YY_BEGIN)) goto l242;
 #undef yytext
 #undef yyleng
   }
-  {  int yypos112= yy->__pos, yythunkpos112= yy->__thunkpos;  if (!yy_eol(yy)) goto l112;  goto l109;
-  l112:;	  yy->__pos= yypos112; yy->__thunkpos= yythunkpos112;
-  }  if (!yymatchDot(yy)) goto l109;
-  l110:;	
-  {  int yypos111= yy->__pos, yythunkpos111= yy->__thunkpos;
-  {  int yypos113= yy->__pos, yythunkpos113= yy->__thunkpos;  if (!yy_eol(yy)) goto l113;  goto l111;
-  l113:;	  yy->__pos= yypos113; yy->__thunkpos= yythunkpos113;
-  }  if (!yymatchDot(yy)) goto l111;  goto l110;
-  l111:;	  yy->__pos= yypos111; yy->__thunkpos= yythunkpos111;
+  {  int yypos245= yy->__pos, yythunkpos245= yy->__thunkpos;  if (!yy_eol(yy)) goto l245;  goto l242;
+  l245:;	  yy->__pos= yypos245; yy->__thunkpos= yythunkpos245;
+  }  if (!yymatchDot(yy)) goto l242;
+  l243:;	
+  {  int yypos244= yy->__pos, yythunkpos244= yy->__thunkpos;
+  {  int yypos246= yy->__pos, yythunkpos246= yy->__thunkpos;  if (!yy_eol(yy)) goto l246;  goto l244;
+  l246:;	  yy->__pos= yypos246; yy->__thunkpos= yythunkpos246;
+  }  if (!yymatchDot(yy)) goto l244;  goto l243;
+  l244:;	  yy->__pos= yypos244; yy->__thunkpos= yythunkpos244;
   }  yyText(yy, yy->__begin, yy->__end);  {
 #define yytext yy->__text
 #define yyleng yy->__textlen
-if (!(YY_END)) goto l109;
+if (!(YY_END)) goto l242;
 #undef yytext
 #undef yyleng
-  }  if (!yy_eol(yy)) goto l109;  yyDo(yy, yy_1_invalid_syntax, yy->__begin, yy->__end);
+  }  if (!yy_eol(yy)) goto l242;  yyDo(yy, yy_1_invalid_syntax, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "invalid_syntax", yy->__buf+yy->__pos));
   return 1;
-  l109:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l242:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "invalid_syntax", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_eol(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
   yyprintf((stderr, "%s\n", "eol"));
-  {  int yypos115= yy->__pos, yythunkpos115= yy->__thunkpos;
-  {  int yypos117= yy->__pos, yythunkpos117= yy->__thunkpos;  if (!yymatchChar(yy, '\r')) goto l117;  goto l118;
-  l117:;	  yy->__pos= yypos117; yy->__thunkpos= yythunkpos117;
+  {  int yypos248= yy->__pos, yythunkpos248= yy->__thunkpos;
+  {  int yypos250= yy->__pos, yythunkpos250= yy->__thunkpos;  if (!yymatchChar(yy, '\r')) goto l250;  goto l251;
+  l250:;	  yy->__pos= yypos250; yy->__thunkpos= yythunkpos250;
   }
-  l118:;	  if (!yymatchChar(yy, '\n')) goto l116;  goto l115;
-  l116:;	  yy->__pos= yypos115; yy->__thunkpos= yythunkpos115;  if (!yy_eof(yy)) goto l114;
+  l251:;	  if (!yymatchChar(yy, '\n')) goto l249;  goto l248;
+  l249:;	  yy->__pos= yypos248; yy->__thunkpos= yythunkpos248;  if (!yy_eof(yy)) goto l247;
   }
-  l115:;	
+  l248:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "eol", yy->__buf+yy->__pos));
   return 1;
-  l114:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l247:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "eol", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_line(yycontext *yy)
 {  int yypos0= yy->__pos, yythunkpos0= yy->__thunkpos;
   yyprintf((stderr, "%s\n", "line"));
-  {  int yypos120= yy->__pos, yythunkpos120= yy->__thunkpos;  if (!yy__(yy)) goto l120;  goto l121;
-  l120:;	  yy->__pos= yypos120; yy->__thunkpos= yythunkpos120;
+  {  int yypos253= yy->__pos, yythunkpos253= yy->__thunkpos;  if (!yy__(yy)) goto l253;  goto l254;
+  l253:;	  yy->__pos= yypos253; yy->__thunkpos= yythunkpos253;
   }
-  l121:;	
-  {  int yypos122= yy->__pos, yythunkpos122= yy->__thunkpos;  if (!yy_command(yy)) goto l122;
-  {  int yypos124= yy->__pos, yythunkpos124= yy->__thunkpos;  if (!yy__(yy)) goto l124;  goto l125;
-  l124:;	  yy->__pos= yypos124; yy->__thunkpos= yythunkpos124;
+  l254:;	
+  {  int yypos255= yy->__pos, yythunkpos255= yy->__thunkpos;  if (!yy_command(yy)) goto l255;
+  {  int yypos257= yy->__pos, yythunkpos257= yy->__thunkpos;  if (!yy__(yy)) goto l257;  goto l258;
+  l257:;	  yy->__pos= yypos257; yy->__thunkpos= yythunkpos257;
   }
-  l125:;	  goto l123;
-  l122:;	  yy->__pos= yypos122; yy->__thunkpos= yythunkpos122;
+  l258:;	  goto l256;
+  l255:;	  yy->__pos= yypos255; yy->__thunkpos= yythunkpos255;
   }
-  l123:;	
-  {  int yypos126= yy->__pos, yythunkpos126= yy->__thunkpos;  if (!yy_comment(yy)) goto l126;  goto l127;
-  l126:;	  yy->__pos= yypos126; yy->__thunkpos= yythunkpos126;
+  l256:;	
+  {  int yypos259= yy->__pos, yythunkpos259= yy->__thunkpos;  if (!yy_comment(yy)) goto l259;  goto l260;
+  l259:;	  yy->__pos= yypos259; yy->__thunkpos= yythunkpos259;
   }
-  l127:;	
+  l260:;	
   yyprintf((stderr, "  ok   %s @ %s\n", "line", yy->__buf+yy->__pos));
   return 1;
-  l119:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l252:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "line", yy->__buf+yy->__pos));
   return 0;
 }
@@ -1280,20 +2570,20 @@ YY_RULE(int) yy_sol(yycontext *yy)
   yyprintf((stderr, "%s\n", "sol"));  yyDo(yy, yy_1_sol, yy->__begin, yy->__end);
   yyprintf((stderr, "  ok   %s @ %s\n", "sol", yy->__buf+yy->__pos));
   return 1;
-  l128:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
+  l261:;	  yy->__pos= yypos0; yy->__thunkpos= yythunkpos0;
   yyprintf((stderr, "  fail %s @ %s\n", "sol", yy->__buf+yy->__pos));
   return 0;
 }
 YY_RULE(int) yy_file(yycontext *yy)
 {
   yyprintf((stderr, "%s\n", "file"));
-  l130:;	
-  {  int yypos131= yy->__pos, yythunkpos131= yy->__thunkpos;  if (!yy_sol(yy)) goto l131;
-  {  int yypos132= yy->__pos, yythunkpos132= yy->__thunkpos;  if (!yy_line(yy)) goto l133;  if (!yy_eol(yy)) goto l133;  goto l132;
-  l133:;	  yy->__pos= yypos132; yy->__thunkpos= yythunkpos132;  if (!yy_invalid_syntax(yy)) goto l131;
+  l263:;	
+  {  int yypos264= yy->__pos, yythunkpos264= yy->__thunkpos;  if (!yy_sol(yy)) goto l264;
+  {  int yypos265= yy->__pos, yythunkpos265= yy->__thunkpos;  if (!yy_line(yy)) goto l266;  if (!yy_eol(yy)) goto l266;  goto l265;
+  l266:;	  yy->__pos= yypos265; yy->__thunkpos= yythunkpos265;  if (!yy_invalid_syntax(yy)) goto l264;
   }
-  l132:;	  goto l130;
-  l131:;	  yy->__pos= yypos131; yy->__thunkpos= yythunkpos131;
+  l265:;	  goto l263;
+  l264:;	  yy->__pos= yypos264; yy->__thunkpos= yythunkpos264;
   }
   yyprintf((stderr, "  ok   %s @ %s\n", "file", yy->__buf+yy->__pos));
   return 1;
@@ -1346,7 +2636,7 @@ YY_PARSE(yycontext *) YYRELEASE(yycontext *yyctx)
 }
 
 #endif
-#line 160 "parse.peg"
+#line 387 "parse.peg"
 
 
 void parseConfiguration(char const *file)
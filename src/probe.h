@@ -0,0 +1,28 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Static tracepoints for bpftrace, perf and SystemTap, listed in the
+	TRACING section of the manual page. Each one is a single no-op
+	instruction until a tracer attaches to it. The first arguments are
+	always the connection index, or -1, and the rule index. */
+
+#if HAVE_SYS_SDT_H
+#	include <sys/sdt.h>
+#	define PROBE2(name, a, b) DTRACE_PROBE2(rinetd, name, a, b)
+#	define PROBE3(name, a, b, c) DTRACE_PROBE3(rinetd, name, a, b, c)
+#	define PROBE4(name, a, b, c, d) DTRACE_PROBE4(rinetd, name, a, b, c, d)
+#else
+	/* Arguments have no side effects, and are optimised out */
+#	define PROBE2(name, a, b) do { (void)(a); (void)(b); } while (0)
+#	define PROBE3(name, a, b, c) do { (void)(a); (void)(b); \
+		(void)(c); } while (0)
+#	define PROBE4(name, a, b, c, d) do { (void)(a); (void)(b); \
+		(void)(c); (void)(d); } while (0)
+#endif
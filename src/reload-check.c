@@ -0,0 +1,182 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+/* Checks of reloads, run by "make check": a connection opened before
+	SIGHUP keeps relaying after it, once its buffers are old enough to
+	be resized, see sizeBuffer(). */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+
+#include "net.h"
+#include "uring.h"
+
+static int failures;
+static char const daemonPath[] = "../rinetd";
+
+static void checkEngine(char const *engine);
+static SOCKET listenLoopback(int *port);
+static int relay(SOCKET client, SOCKET backend, char const *message);
+static int receiveAll(SOCKET fd, char *buffer, int length);
+static void check(int ok, char const *what, char const *engine);
+
+int main(void)
+{
+	signal(SIGPIPE, SIG_IGN);
+	checkEngine("select");
+#if HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE1
+	checkEngine("epoll");
+#endif
+#if HAVE_URING
+	checkEngine("io_uring");
+#endif
+	printf("%s\n", failures ? "FAIL" : "PASS");
+	return failures ? 1 : 0;
+}
+
+static void checkEngine(char const *engine)
+{
+	/* The backend listens here, and the rule forwards a port that was
+		free a moment ago */
+	int backendPort, rulePort;
+	SOCKET backendListen = listenLoopback(&backendPort);
+	SOCKET probe = listenLoopback(&rulePort);
+	closesocket(probe);
+
+	char conf[] = "/tmp/rinetd-check-XXXXXX";
+	int confFd = mkstemp(conf);
+	if (confFd < 0) {
+		exit(1);
+	}
+	FILE *out = fdopen(confFd, "w");
+	fprintf(out, "127.0.0.1 %d 127.0.0.1 %d\n", rulePort, backendPort);
+	fclose(out);
+
+	pid_t pid = fork();
+	if (pid < 0) {
+		exit(1);
+	}
+	if (!pid) {
+		execl(daemonPath, daemonPath, "-f", "-c", conf, "-e", engine,
+			(char *)NULL);
+		_exit(127);
+	}
+
+	/* Give the daemon up to two seconds to listen */
+	SOCKET client = INVALID_SOCKET;
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(rulePort);
+	for (int i = 0; i < 40 && client == INVALID_SOCKET; ++i) {
+		usleep(50000);
+		client = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(client, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+			closesocket(client);
+			client = INVALID_SOCKET;
+		}
+	}
+
+	SOCKET backend = INVALID_SOCKET;
+	if (client != INVALID_SOCKET) {
+		struct pollfd pfd = { backendListen, POLLIN, 0 };
+		if (poll(&pfd, 1, 2000) > 0) {
+			backend = accept(backendListen, NULL, NULL);
+		}
+	}
+	check(backend != INVALID_SOCKET, "connection relayed", engine);
+
+	if (backend != INVALID_SOCKET) {
+		check(relay(client, backend, "before reload"),
+			"data relayed before reload", engine);
+		/* Buffers are resized at most once a second */
+		usleep(1500000);
+		kill(pid, SIGHUP);
+		usleep(300000);
+		check(relay(client, backend, "after reload"),
+			"data relayed after reload", engine);
+		closesocket(backend);
+	}
+	if (client != INVALID_SOCKET) {
+		closesocket(client);
+	}
+
+	int status;
+	check(waitpid(pid, &status, WNOHANG) == 0, "daemon still running",
+		engine);
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	closesocket(backendListen);
+	unlink(conf);
+}
+
+static SOCKET listenLoopback(int *port)
+{
+	SOCKET fd = socket(AF_INET, SOCK_STREAM, 0);
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	socklen_t length = sizeof(addr);
+	if (fd == INVALID_SOCKET
+		|| bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0
+		|| listen(fd, 4) < 0
+		|| getsockname(fd, (struct sockaddr *)&addr, &length) < 0) {
+		exit(1);
+	}
+	*port = ntohs(addr.sin_port);
+	return fd;
+}
+
+/* Sends the message both ways and checks it arrives intact */
+static int relay(SOCKET client, SOCKET backend, char const *message)
+{
+	int length = (int)strlen(message);
+	char buffer[64];
+	if (send(client, message, length, 0) != length
+		|| receiveAll(backend, buffer, length) < 0
+		|| memcmp(buffer, message, length)
+		|| send(backend, message, length, 0) != length
+		|| receiveAll(client, buffer, length) < 0
+		|| memcmp(buffer, message, length)) {
+		return 0;
+	}
+	return 1;
+}
+
+static int receiveAll(SOCKET fd, char *buffer, int length)
+{
+	for (int got = 0; got < length; ) {
+		struct pollfd pfd = { fd, POLLIN, 0 };
+		if (poll(&pfd, 1, 2000) <= 0) {
+			return -1;
+		}
+		int n = recv(fd, buffer + got, length - got, 0);
+		if (n <= 0) {
+			return -1;
+		}
+		got += n;
+	}
+	return 0;
+}
+
+static void check(int ok, char const *what, char const *engine)
+{
+	printf("%s%s (%s)\n", ok ? "ok    " : "FAIL  ", what, engine);
+	failures += !ok;
+}
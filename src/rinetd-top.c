@@ -0,0 +1,373 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+/* Live view of the statistics file written by rinetd, see segment.h.
+	Reading it never makes rinetd wait. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if HAVE_UNISTD_H
+#	include <unistd.h>
+#endif
+#if HAVE_SYS_MMAN_H
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif
+
+#include "segment.h"
+
+#if HAVE_SYS_MMAN_H
+
+typedef struct _top_rule TopRule;
+struct _top_rule
+{
+	int index;
+	/* Sums over all workers, and rates per second */
+	SegmentCounters now;
+	double accepts, in, out;
+};
+
+/* Rates come from the last two distinct publications of each worker,
+	and the time between them, so that they do not depend on when or
+	how often the file is read */
+typedef struct _top_worker TopWorker;
+struct _top_worker
+{
+	SegmentWorker now, before;
+	SegmentCounters *counters, *countersBefore;
+};
+
+typedef struct _top_state TopState;
+struct _top_state
+{
+	SegmentHeader const *header;
+	size_t size;
+	/* Sums over all workers, and rates per second */
+	SegmentWorker total;
+	double loops, syscalls;
+	TopRule *rules;
+	TopWorker *workers;
+	SegmentCounters *counters;
+};
+
+static char const *engineNames[] = { "unknown", "select", "epoll", "io_uring" };
+static char const *protoNames[] = { "?", "tcp", "udp" };
+
+static int topOpen(TopState *state, char const *path);
+static void topClose(TopState *state);
+static void topRead(TopState *state);
+static void topShow(TopState *state, int lines);
+static char const *topSize(double bytes, char *text);
+static int topCompare(void const *a, void const *b);
+
+int main(int argc, char *argv[])
+{
+	char const *path = RINETD_STATS_FILE;
+	int lines = 20, iterations = 0, interval = 1;
+	int opt;
+	while ((opt = getopt(argc, argv, "f:n:i:d:h")) != -1) {
+		switch (opt) {
+			case 'f': path = optarg; break;
+			case 'n': lines = atoi(optarg); break;
+			case 'i': iterations = atoi(optarg); break;
+			case 'd': interval = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+			default:
+				fprintf(stderr, "Usage: rinetd-top [OPTION]\n"
+					"  -f FILE    read FILE instead of %s\n"
+					"  -n COUNT   show at most COUNT rules (default 20)\n"
+					"  -i COUNT   exit after COUNT refreshes\n"
+					"  -d SECONDS wait SECONDS between refreshes "
+					"(default 1)\n", RINETD_STATS_FILE);
+				exit(opt == 'h' ? 0 : 1);
+		}
+	}
+
+	TopState state;
+	memset(&state, 0, sizeof(state));
+	/* Only clear the screen when someone is watching */
+	int terminal = isatty(STDOUT_FILENO);
+	for (int i = 0; !iterations || i < iterations; ++i) {
+		if (i > 0) {
+			sleep((unsigned)interval);
+		}
+		/* rinetd makes a new file when it reloads its configuration */
+		if (state.header && __atomic_load_n(&state.header->retired,
+				__ATOMIC_ACQUIRE)) {
+			topClose(&state);
+		}
+		if (!state.header && topOpen(&state, path) < 0) {
+			if (!iterations) {
+				continue;
+			}
+			return 1;
+		}
+		topRead(&state);
+		if (terminal) {
+			printf("\033[H\033[2J");
+		}
+		topShow(&state, lines);
+		fflush(stdout);
+	}
+	topClose(&state);
+	return 0;
+}
+
+static int topOpen(TopState *state, char const *path)
+{
+	int fd = open(path, O_RDONLY);
+	struct stat st;
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		fprintf(stderr, "rinetd-top: cannot open %s\n", path);
+		if (fd >= 0) {
+			close(fd);
+		}
+		return -1;
+	}
+	void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	SegmentHeader const *header = (SegmentHeader const *)map;
+	if (map == MAP_FAILED || (size_t)st.st_size < sizeof(*header)
+		|| memcmp(header->magic, SEGMENT_MAGIC, sizeof(header->magic))
+		|| header->version != segmentVersion
+		|| header->workerOffset + (uint64_t)header->workerSize
+			* header->workerCount > (uint64_t)st.st_size) {
+		fprintf(stderr, "rinetd-top: %s is not a statistics file\n", path);
+		if (map != MAP_FAILED) {
+			munmap(map, (size_t)st.st_size);
+		}
+		return -1;
+	}
+	state->header = header;
+	state->size = (size_t)st.st_size;
+	state->rules = (TopRule *)calloc(header->ruleCount + 1, sizeof(TopRule));
+	state->workers = (TopWorker *)
+		calloc(header->workerCount, sizeof(TopWorker));
+	state->counters = (SegmentCounters *)
+		calloc(header->ruleCount + 1, sizeof(SegmentCounters));
+	if (!state->rules || !state->workers || !state->counters) {
+		exit(1);
+	}
+	for (uint32_t w = 0; w < header->workerCount; ++w) {
+		TopWorker *worker = &state->workers[w];
+		worker->counters = (SegmentCounters *)
+			calloc(header->ruleCount + 1, sizeof(SegmentCounters));
+		worker->countersBefore = (SegmentCounters *)
+			calloc(header->ruleCount + 1, sizeof(SegmentCounters));
+		if (!worker->counters || !worker->countersBefore) {
+			exit(1);
+		}
+	}
+	return 0;
+}
+
+static void topClose(TopState *state)
+{
+	if (state->header) {
+		for (uint32_t w = 0; w < state->header->workerCount; ++w) {
+			free(state->workers[w].counters);
+			free(state->workers[w].countersBefore);
+		}
+		munmap((void *)state->header, state->size);
+	}
+	free(state->rules);
+	free(state->workers);
+	free(state->counters);
+	state->header = NULL;
+	state->rules = NULL;
+	state->workers = NULL;
+	state->counters = NULL;
+}
+
+static void topRead(TopState *state)
+{
+	SegmentHeader const *header = state->header;
+	uint32_t ruleCount = header->ruleCount;
+	SegmentWorker total;
+	memset(&total, 0, sizeof(total));
+	state->loops = state->syscalls = 0;
+	for (uint32_t r = 0; r < ruleCount; ++r) {
+		TopRule *rule = &state->rules[r];
+		memset(&rule->now, 0, sizeof(SegmentCounters));
+		rule->accepts = rule->in = rule->out = 0;
+		rule->index = (int)r;
+	}
+
+	for (uint32_t w = 0; w < header->workerCount; ++w) {
+		SegmentWorker const *slot = (SegmentWorker const *)
+			((char const *)header + header->workerOffset
+				+ (size_t)header->workerSize * w);
+		SegmentWorker copy;
+		/* Try again while the worker is writing, unless it seems
+			to have died doing so */
+		for (int tries = 0; ; ++tries) {
+			uint32_t sequence = __atomic_load_n(&slot->sequence,
+				__ATOMIC_ACQUIRE);
+			if ((sequence & 1) && tries < 1000000) {
+				continue;
+			}
+			memcpy(&copy, slot, sizeof(copy));
+			memcpy(state->counters, slot + 1,
+				sizeof(SegmentCounters) * ruleCount);
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED)
+				== sequence || tries >= 1000000) {
+				break;
+			}
+		}
+		TopWorker *worker = &state->workers[w];
+		if (copy.updateTime != worker->now.updateTime) {
+			SegmentCounters *swap = worker->countersBefore;
+			worker->countersBefore = worker->counters;
+			worker->counters = swap;
+			memcpy(worker->counters, state->counters,
+				sizeof(SegmentCounters) * ruleCount);
+			worker->before = worker->now;
+			worker->now = copy;
+		}
+
+		SegmentWorker const *now = &worker->now, *before = &worker->before;
+		total.loopCount += now->loopCount;
+		total.syscallCount += now->syscallCount;
+		total.relayedBytes += now->relayedBytes;
+		total.bufferBytes += now->bufferBytes;
+		total.bufferBytesUsed += now->bufferBytesUsed;
+		total.connectionSlots += now->connectionSlots;
+		double elapsed = (double)(now->updateTime - before->updateTime);
+		int rated = before->updateTime && elapsed > 0;
+		if (rated) {
+			state->loops += (double)(now->loopCount
+				- before->loopCount) / elapsed;
+			state->syscalls += (double)(now->syscallCount
+				- before->syscallCount) / elapsed;
+		}
+		for (uint32_t r = 0; r < ruleCount; ++r) {
+			TopRule *rule = &state->rules[r];
+			SegmentCounters *to = &rule->now;
+			SegmentCounters const *from = &worker->counters[r];
+			to->connections += from->connections;
+			to->accepts += from->accepts;
+			to->udpSessions += from->udpSessions;
+			to->notAllowed += from->notAllowed;
+			to->denied += from->denied;
+			to->connectFailures += from->connectFailures;
+			to->bytesIn += from->bytesIn;
+			to->bytesOut += from->bytesOut;
+			if (rated) {
+				SegmentCounters const *old = &worker->countersBefore[r];
+				rule->accepts += (double)(from->accepts - old->accepts
+					+ from->udpSessions - old->udpSessions) / elapsed;
+				rule->in += (double)(from->bytesIn - old->bytesIn)
+					/ elapsed;
+				rule->out += (double)(from->bytesOut - old->bytesOut)
+					/ elapsed;
+			}
+		}
+	}
+	state->total = total;
+}
+
+static void topShow(TopState *state, int lines)
+{
+	SegmentHeader const *header = state->header;
+	SegmentWorker const *total = &state->total;
+	SegmentRule const *rules = (SegmentRule const *)
+		((char const *)header + header->ruleOffset);
+
+	unsigned long long connections = 0;
+	double in = 0, out = 0, accepts = 0;
+	for (uint32_t r = 0; r < header->ruleCount; ++r) {
+		TopRule const *rule = &state->rules[r];
+		connections += rule->now.connections;
+		in += rule->in;
+		out += rule->out;
+		accepts += rule->accepts;
+	}
+
+	time_t now = time(NULL);
+	long uptime = (long)(now - header->startTime);
+	char clock[16], text[4][16];
+	strftime(clock, sizeof(clock), "%H:%M:%S", localtime(&now));
+	printf("rinetd-top - %s up %ldd %02ld:%02ld, %s, %u workers, "
+			"%llu connections, %llu slots\n",
+		clock, uptime / 86400, uptime / 3600 % 24, uptime / 60 % 60,
+		engineNames[header->engine < 4 ? header->engine : 0],
+		header->workerCount, connections,
+		(unsigned long long)total->connectionSlots);
+	printf("in %s/s  out %s/s  %.0f accepts/s  %.0f loops/s  "
+			"%.0f syscalls/s  buffers %s/%s\n\n",
+		topSize(in, text[0]), topSize(out, text[1]), accepts,
+		state->loops, state->syscalls,
+		topSize((double)total->bufferBytesUsed, text[2]),
+		topSize((double)total->bufferBytes, text[3]));
+
+	/* Busiest rules first */
+	qsort(state->rules, header->ruleCount, sizeof(TopRule), topCompare);
+	printf("%7s %9s %9s %9s %8s %8s  %s\n", "CONNS", "ACCEPT/s",
+		"IN/s", "OUT/s", "REFUSED", "FAILED", "RULE");
+	for (uint32_t r = 0; r < header->ruleCount && (int)r < lines; ++r) {
+		TopRule const *rule = &state->rules[r];
+		SegmentRule const *info = &rules[rule->index];
+		printf("%7llu %9.0f %9s %9s %8llu %8llu  %.64s:%u/%s -> %.64s:%u/%s\n",
+			(unsigned long long)rule->now.connections, rule->accepts,
+			topSize(rule->in, text[0]), topSize(rule->out, text[1]),
+			(unsigned long long)(rule->now.notAllowed + rule->now.denied),
+			(unsigned long long)rule->now.connectFailures,
+			info->fromHost, info->fromPort, protoNames[info->fromProto % 3],
+			info->toHost, info->toPort, protoNames[info->toProto % 3]);
+	}
+	/* Keep rules in file order for the next reading */
+	for (uint32_t r = 0; r < header->ruleCount; ++r) {
+		while (state->rules[r].index != (int)r) {
+			TopRule swap = state->rules[state->rules[r].index];
+			state->rules[state->rules[r].index] = state->rules[r];
+			state->rules[r] = swap;
+		}
+	}
+}
+
+static char const *topSize(double bytes, char *text)
+{
+	char const *units = "BKMGT";
+	while (bytes >= 1024 && units[1]) {
+		bytes /= 1024;
+		++units;
+	}
+	sprintf(text, units[0] == 'B' ? "%.0f%c" : "%.1f%c", bytes, units[0]);
+	return text;
+}
+
+static int topCompare(void const *a, void const *b)
+{
+	TopRule const *ra = (TopRule const *)a, *rb = (TopRule const *)b;
+	double rateA = ra->in + ra->out, rateB = rb->in + rb->out;
+	if (rateA != rateB) {
+		return rateA < rateB ? 1 : -1;
+	}
+	if (ra->now.connections != rb->now.connections) {
+		return ra->now.connections < rb->now.connections ? 1 : -1;
+	}
+	return ra->index - rb->index;
+}
+
+#else
+
+int main(void)
+{
+	fprintf(stderr, "rinetd-top: statistics files are not supported "
+		"on this system\n");
+	return 1;
+}
+
+#endif /* HAVE_SYS_MMAN_H */
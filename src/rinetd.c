@@ -35,6 +35,20 @@
 #	include <time.h>
 #endif
 #include <ctype.h>
+#include <stdint.h>
+
+#if HAVE_SPLICE && HAVE_PIPE2 && defined SPLICE_F_NONBLOCK
+#	define HAVE_ZERO_COPY 1
+#endif
+
+#if HAVE_RECVMMSG && HAVE_SENDMMSG
+#	define HAVE_MMSG 1
+#endif
+
+#if HAVE_SYS_EPOLL_H && HAVE_EPOLL_CREATE1
+#	include <sys/epoll.h>
+#	define HAVE_EPOLL 1
+#endif
 
 #ifdef DEBUG
 #	define PERROR perror
@@ -47,16 +61,64 @@
 #include "types.h"
 #include "rinetd.h"
 #include "parse.h"
+#include "uring.h"
+#include "timer.h"
+#include "log.h"
+#include "stats.h"
+#include "segment.h"
+#include "histogram.h"
+#include "probe.h"
+#include "watchdog.h"
+#include "flight.h"
+#include "balance.h"
+#include "health.h"
+
+#if HAVE_URING
+#	include <poll.h>
+#endif
 
 Rule *allRules = NULL;
 int allRulesCount = 0;
 int globalRulesCount = 0;
 
-ServerInfo *seInfo = NULL;
-int seTotal = 0;
-
-ConnectionInfo *coInfo = NULL;
-int coTotal = 0;
+ServerInfo *allServers = NULL;
+int allServersCount = 0;
+
+int workerCount = 1;
+
+/* Worker threads, the first one being the main thread */
+WorkerInfo *woInfo = NULL;
+int woTotal = 0;
+static THREAD_LOCAL WorkerInfo *worker = NULL;
+
+/* Each worker has its own copy of the servers, with its own sockets,
+	and its own connections. */
+static THREAD_LOCAL ServerInfo *seInfo = NULL;
+static THREAD_LOCAL int seTotal = 0;
+
+/* The stats listener, if any, is only opened by the main thread,
+	after the other servers */
+static ServerInfo statsServer;
+
+/* Connections live in segments that never move, so that pointers to
+	them stay valid as the table grows. The first segment holds 8
+	connections and each following one twice as many as the previous
+	one. Unused connections are kept in a free list. */
+#define CO_FIRST_SEGMENT_BITS 3
+static THREAD_LOCAL ConnectionInfo *coSegments[32];
+static THREAD_LOCAL int coSegmentCount = 0;
+static THREAD_LOCAL int coTotal = 0;
+static THREAD_LOCAL ConnectionInfo *coFree = NULL;
+
+/* Flight recorder events, one block per connection segment, see
+	addFlights() */
+static THREAD_LOCAL FlightEvent *coFlights[32];
+
+/* UDP connections, indexed by server socket and client address so
+	that each incoming datagram finds its connection quickly. */
+static THREAD_LOCAL ConnectionInfo **udpHash = NULL;
+static THREAD_LOCAL unsigned udpHashSize = 0;
+static THREAD_LOCAL unsigned udpHashCount = 0;
 
 /* On Windows, the maximum number of file descriptors in an fd_set
 	is simply FD_SETSIZE and the first argument to select() is
@@ -64,67 +126,230 @@ int coTotal = 0;
 #ifdef _WIN32
 int const maxfd = 0;
 #else
-int maxfd = 0;
+static THREAD_LOCAL int maxfd = 0;
 #endif
 
-/* Global static buffer for UDP data. */
-static char globalUdpBuffer[65536];
+/* Static buffer for UDP data. */
+static THREAD_LOCAL char globalUdpBuffer[65536];
+
+#if HAVE_MMSG
+/* Batched UDP: datagrams received at once by handleUdpBatch(), each
+	in its own part of udpBatchBuffer, and replies waiting to be sent
+	at once by flushUdpReplies(). */
+static THREAD_LOCAL struct mmsghdr *udpMessages = NULL;
+static THREAD_LOCAL struct iovec *udpVectors = NULL;
+static THREAD_LOCAL struct sockaddr_in *udpAddresses = NULL;
+static THREAD_LOCAL char *udpBatchBuffer = NULL;
+static THREAD_LOCAL struct mmsghdr *udpReplyMessages = NULL;
+static THREAD_LOCAL struct iovec *udpReplyVectors = NULL;
+static THREAD_LOCAL ConnectionInfo **udpReplies = NULL;
+static THREAD_LOCAL int udpReplyCount = 0;
+static THREAD_LOCAL int udpFlushing = 0;
+#endif
 
-char *logFileName = NULL;
-char *pidLogFileName = NULL;
-int logFormatCommon = 0;
-FILE *logFile = NULL;
+/* Connection buffers are carved out of slabs, and only held while
+	data is in flight. Unused ones are kept in one free list per size,
+	from RINETD_MIN_BUFFER_SIZE to RINETD_MAX_BUFFER_SIZE, with the
+	next one pointed to by their first bytes. */
+static THREAD_LOCAL char **bufferSlabs = NULL;
+static THREAD_LOCAL int bufferSlabCount = 0;
+static THREAD_LOCAL char *bufferFree[13];
+
+#if HAVE_ZERO_COPY
+/* Empty pipes kept for reuse by spliced connections */
+static THREAD_LOCAL int (*pipePool)[2] = NULL;
+static THREAD_LOCAL int pipePoolCount = 0;
+#endif
 
-char const *logMessages[] = {
-        "unknown-error",
-	"done-local-closed",
-	"done-remote-closed",
-	"accept-failed -",
-	"local-socket-failed -",
-	"local-bind-failed -",
-	"local-connect-failed -",
-	"opened",
-	"not-allowed",
-	"denied",
+char const *engineNames[] = {
+	"unknown",
+	"select",
+	"epoll",
+	"io_uring",
 };
 
+#if HAVE_EPOLL
+/* The epoll engine keeps one registration per socket. The event data
+	holds the file descriptor in its upper 32 bits, and the lower 32 bits
+	are either a server index with EPOLL_SERVER_TAG set, a health check
+	probe index with EPOLL_PROBE_TAG set, or a connection index times two
+	plus one for the local socket. */
+#	define EPOLL_SERVER_TAG 0x80000000u
+#	define EPOLL_PROBE_TAG 0x40000000u
+static THREAD_LOCAL int epollFd = -1;
+/* Connection sockets registered, for statistics */
+static THREAD_LOCAL int epollWatched = 0;
+#endif
+
+/* The io_uring engine keeps at most one receive and one send in flight
+	per socket, plus an accept or poll per server socket. The completion
+	data holds the file descriptor in its upper 32 bits, the operation in
+	the next 4 bits, then the same index as for epoll. */
 enum {
-	logUnknownError = 0,
-	logLocalClosedFirst,
-	logRemoteClosedFirst,
-	logAcceptFailed,
-	logLocalSocketFailed,
-	logLocalBindFailed,
-	logLocalConnectFailed,
-	logOpened,
-	logAllowed,
-	logNotAllowed,
-	logDenied,
+	uringRecv = 1,
+	uringSend = 2,
+	uringAccept = 4,
+	uringPoll,
+	uringTimeout,
+	uringIgnore,
+	/* Waiting for data before taking a buffer to receive it */
+	uringReadable = 8,
+	/* Health check sockets, see watchProbe() */
+	uringProbe,
+	/* Server sockets full of UDP replies, see watchUdpWritable() */
+	uringWritable,
 };
+#if HAVE_URING
+#	define URING_DATA(fd, op, tag) ((uint64_t)(unsigned)(fd) << 32 \
+		| (uint64_t)(op) << 28 | (tag))
+/* Deadline of the last timeout submitted, if it has not completed yet */
+static THREAD_LOCAL time_t uringTimerDeadline = 0;
+static THREAD_LOCAL unsigned uringTimerGeneration = 0;
+static THREAD_LOCAL struct __kernel_timespec uringTimerDelay;
+/* Operations submitted and not completed yet, for statistics */
+static THREAD_LOCAL int uringInFlight = 0;
+#endif
+
+/* When the last wait for events ended, see loopWaited() */
+static THREAD_LOCAL long long loopWoken = 0;
+
+static volatile sig_atomic_t reloadRequested = 0;
+static volatile sig_atomic_t statsRequested = 0;
+static volatile sig_atomic_t quitRequested = 0;
+
+#if HAVE_WORKERS
+/* The main thread reloads the configuration while the other workers
+	wait with their server sockets closed. */
+static pthread_mutex_t reloadLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reloadCond = PTHREAD_COND_INITIALIZER;
+static int reloadPending = 0;
+static int reloadStopped = 0;
+/* The other workers leave their event loop before quitting */
+static int quitPending = 0;
+static int quitStopped = 0;
+#endif
+
+char *logFileName = NULL;
+char *pidLogFileName = NULL;
+char *statsFileName = NULL;
+int watchdogThreshold = 0;
+int flightLatency = 0, flightDuration = 0;
+int logFormat = logFormatTab;
+int logCloseOnly = 0;
+FILE *logFile = NULL;
 
 RinetdOptions options = {
 	RINETD_CONFIG_FILE,
 	0,
+#if HAVE_EPOLL
+	engineEpoll,
+#else
+	engineSelect,
+#endif
 };
 
+static void eventPass(void);
+static long long loopWaiting(void);
+static void loopWaited(long long before, int watched, int ready);
+static void countCall(int kind, long got);
+static int setPhase(int phase);
 static void selectPass(void);
+static void epollPass(void);
+static void uringPass(void);
+#if HAVE_URING
+static void uringArmServer(int index);
+static void uringArmRecv(Socket *socket, Socket const *other_socket,
+	unsigned tag);
+static void uringClose(SOCKET fd);
+#endif
+static void openServers(void);
+static void closeServers(void);
+static void registerServers(void);
+static void watchProbe(SOCKET fd, int probe, int writable);
+static void closeProbe(SOCKET fd);
+static void updateInterest(ConnectionInfo *cnx);
+static void handleTimeout(Timer *timer);
+static void closeSocket(ConnectionInfo *cnx, Socket *socket);
+static int getBuffer(ConnectionInfo const *cnx, Socket *socket);
+static void closeUnbuffered(ConnectionInfo *cnx, Socket *socket,
+	Socket *other_socket);
+static void resizeBuffer(ConnectionInfo const *cnx, Socket *socket,
+	Socket *other_socket);
+static int sizeBuffer(ConnectionInfo const *cnx, Socket *socket);
+static int bufferCapacity(Socket const *socket);
+static void freeBuffer(Socket *socket);
+static char *takeBuffer(int size);
+static void releaseBuffer(char *buffer, int size);
+static void freeBuffers(void);
+#if HAVE_ZERO_COPY
+static void chooseRelayMode(Socket *socket, Socket const *other_socket);
+static void releasePipe(Socket *socket, int empty);
+#endif
 static void handleWrite(ConnectionInfo *cnx, Socket *socket, Socket *other_socket);
 static void handleRead(ConnectionInfo *cnx, Socket *socket, Socket *other_socket);
 static void handleUdpRead(ConnectionInfo *cnx, char const *buffer, int bytes);
+static void handleSent(ConnectionInfo *cnx, Socket *socket,
+	Socket *other_socket, int got);
+static void handleStatsRequest(ConnectionInfo *cnx);
+static int getRecvVectors(Socket const *socket, Socket const *other_socket,
+	struct iovec *iov);
+static int getSendVectors(Socket const *socket, Socket const *other_socket,
+	struct iovec *iov);
+static int getVectors(char *buffer, int size, int start, int length,
+	struct iovec *iov);
+#if HAVE_MMSG
+static int allocUdpBatch(void);
+static void freeUdpBatch(void);
+static void handleUdpBatch(ServerInfo const *srv);
+static void forwardUdpData(ConnectionInfo *cnx, char const *data, int bytes);
+static void queueUdpReply(ConnectionInfo *cnx);
+static void flushUdpReplies(void);
+static void watchUdpWritable(ServerInfo const *server);
+#endif
 static void handleClose(ConnectionInfo *cnx, Socket *socket, Socket *other_socket);
+static void handleConnect(ConnectionInfo *cnx);
 static void handleAccept(ServerInfo const *srv);
+static void handleAcceptSocket(ServerInfo const *srv);
+static void openConnection(ServerInfo const *srv, SOCKET nfd,
+                           struct sockaddr const *addr,
+                           char const *udpData, int udpBytes);
+static int connectBackend(ConnectionInfo *cnx);
+static int retryConnection(ConnectionInfo *cnx);
+static ConnectionInfo *getConnection(int index);
 static ConnectionInfo *findAvailableConnection(void);
-static void setConnectionCount(int newCount);
+static void releaseConnection(ConnectionInfo *cnx);
+static int addConnections(void);
+static void addFlights(void);
+static void freeConnections(void);
+static unsigned udpHashKey(SOCKET fd, struct sockaddr_in const *addr);
+static ConnectionInfo *findUdpConnection(SOCKET fd, struct sockaddr_in const *addr);
+static void addUdpConnection(ConnectionInfo *cnx);
+static void removeUdpConnection(ConnectionInfo *cnx);
 static int getAddress(char const *host, struct in_addr *iaddr);
 static int checkConnectionAllowed(ConnectionInfo const *cnx);
+static int ruleIndex(ServerInfo const *srv);
 
 static int readArgs (int argc, char **argv, RinetdOptions *options);
 static void clearConfiguration(void);
 static void readConfiguration(char const *file);
+static void reloadConfiguration(void);
+static void logStatistics(void);
+static void shutdownGracefully(void);
+#if HAVE_WORKERS
+static void interruptWorkers(int const *stopped);
+#endif
+static void connectFailed(ConnectionInfo *cnx, int error);
+static long long recordLatency(ConnectionInfo *cnx, Histogram *histogram);
+static void flightDumpConnections(void);
+static void publishCounters(Timer *timer);
+static void startWorkers(void);
+#if HAVE_WORKERS
+static void *workerThread(void *arg);
+static void waitForReload(void);
+#endif
 
 static void registerPID(char const *pid_file_name);
 static void logEvent(ConnectionInfo const *cnx, ServerInfo const *srv, int result);
-static struct tm *get_gmtoff(int *tz);
 
 /* Signal handlers */
 #if !HAVE_SIGACTION && !_WIN32
@@ -132,6 +357,10 @@ static RETSIGTYPE plumber(int s);
 #endif
 #if !_WIN32
 static RETSIGTYPE hup(int s);
+static RETSIGTYPE usr1(int s);
+#endif
+#if HAVE_WORKERS
+static RETSIGTYPE wake(int s);
 #endif
 static RETSIGTYPE quit(int s);
 
@@ -173,12 +402,53 @@ int main(int argc, char *argv[])
 	sigaction(SIGPIPE, &act, NULL);
 	act.sa_handler = &hup;
 	sigaction(SIGHUP, &act, NULL);
-#elif !_WIN32
+	act.sa_handler = &usr1;
+	sigaction(SIGUSR1, &act, NULL);
+#	if HAVE_WORKERS
+	/* Interrupts the event loop of workers, see reloadConfiguration() */
+	act.sa_handler = &wake;
+	act.sa_flags = 0;
+	sigaction(SIGUSR2, &act, NULL);
+#	endif
+	/* Interrupt the wait for events, whatever the engine */
+	act.sa_handler = &quit;
+	act.sa_flags = 0;
+	sigaction(SIGINT, &act, NULL);
+	sigaction(SIGTERM, &act, NULL);
+#else
+#	if !_WIN32
 	signal(SIGPIPE, plumber);
 	signal(SIGHUP, hup);
-#endif
+	signal(SIGUSR1, usr1);
+#	endif
 	signal(SIGINT, quit);
 	signal(SIGTERM, quit);
+#endif
+
+#if HAVE_URING
+	if (options.engine == engineUring
+		&& uringInit(RINETD_URING_ENTRIES) < 0) {
+#	if HAVE_EPOLL
+		syslog(LOG_ERR, "io_uring_setup(): %m, "
+			"falling back to epoll\n");
+		options.engine = engineEpoll;
+#	else
+		syslog(LOG_ERR, "io_uring_setup(): %m, "
+			"falling back to select()\n");
+		options.engine = engineSelect;
+#	endif
+	}
+#endif
+#if HAVE_EPOLL
+	if (options.engine == engineEpoll) {
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd < 0) {
+			syslog(LOG_ERR, "epoll_create1(): %m, "
+				"falling back to select()\n");
+			options.engine = engineSelect;
+		}
+	}
+#endif
 
 	readConfiguration(options.conf_file);
 	if (pidLogFileName || !options.foreground) {
@@ -186,32 +456,51 @@ int main(int argc, char *argv[])
 	}
 
 	syslog(LOG_INFO, "Starting redirections...\n");
+	logStart();
+	startWorkers();
+	watchdogStart();
+	openServers();
 	while (1) {
-		selectPass();
+		eventPass();
+		if (reloadRequested) {
+			reloadRequested = 0;
+			reloadConfiguration();
+		}
+		if (statsRequested) {
+			statsRequested = 0;
+			logStatistics();
+		}
+		if (quitRequested) {
+			shutdownGracefully();
+		}
 	}
 
 	return 0;
 }
 
 static void clearConfiguration(void) {
-	/* Remove references to server information */
-	for (int i = 0; i < coTotal; ++i) {
-		ConnectionInfo *cnx = &coInfo[i];
-		cnx->server = NULL;
-	}
-	/* Close existing server sockets. */
-	for (int i = 0; i < seTotal; ++i) {
-		ServerInfo *srv = &seInfo[i];
-		if (srv->fd != INVALID_SOCKET) {
-			closesocket(srv->fd);
-		}
+	/* Forget existing servers. Workers must have closed their
+		copies already. */
+	for (int i = 0; i < allServersCount; ++i) {
+		ServerInfo *srv = &allServers[i];
 		free(srv->fromHost);
-		free(srv->toHost);
+		/* The forwarded-to host is the one of the first backend */
+		for (int b = 0; b < srv->backendCount; ++b) {
+			free(srv->backends[b].host);
+		}
+		free(srv->backends);
+		free(srv->schedule);
+		free(srv->lookup);
+		free(srv->checkSend);
+		free(srv->checkExpect);
 	}
 	/* Free memory associated with previous set. */
-	free(seInfo);
-	seInfo = NULL;
-	seTotal = 0;
+	free(allServers);
+	allServers = NULL;
+	allServersCount = 0;
+	free(statsServer.fromHost);
+	memset(&statsServer, 0, sizeof(statsServer));
+	workerCount = 1;
 	/* Forget existing rules. */
 	for (int i = 0; i < allRulesCount; ++i) {
 		free(allRules[i].pattern);
@@ -223,14 +512,25 @@ static void clearConfiguration(void) {
 	/* Free file names */
 	free(logFileName);
 	logFileName = NULL;
+	logFormat = logFormatTab;
+	logCloseOnly = 0;
 	free(pidLogFileName);
 	pidLogFileName = NULL;
+	free(statsFileName);
+	statsFileName = NULL;
+	watchdogThreshold = 0;
+	flightLatency = flightDuration = 0;
 }
 
 static void readConfiguration(char const *file) {
 
 	/* Parse the configuration file. */
 	parseConfiguration(file);
+	for (int i = 0; i < allServersCount; ++i) {
+		if (balanceSchedule(&allServers[i]) < 0) {
+			exit(1);
+		}
+	}
 
 	/* Open the log file */
 	if (logFile) {
@@ -238,7 +538,10 @@ static void readConfiguration(char const *file) {
 		logFile = NULL;
 	}
 	if (logFileName) {
-		logFile = fopen(logFileName, "a");
+		int phase = setPhase(phaseLog);
+		logFile = fopen(logFileName,
+			logFormat == logFormatBinary ? "ab" : "a");
+		setPhase(phase);
 		if (logFile) {
 			setvbuf(logFile, NULL, _IONBF, 0);
 		} else {
@@ -246,15 +549,19 @@ static void readConfiguration(char const *file) {
 				logFileName);
 		}
 	}
+
+	/* Workers are started after the first reading */
+	segmentOpen(statsFileName, woTotal ? woTotal : workerCount);
 }
 
 void addServer(char *bindAddress, int bindPort, int bindProto,
                char *connectAddress, int connectPort, int connectProto,
-               int serverTimeout, char *sourceAddress)
+               int serverTimeout, int udpBatch, int bufferMin, int bufferMax,
+               char *sourceAddress, int balance, int weight)
 {
 	/* Turn all of this stuff into reasonable addresses */
-	struct in_addr iaddr;
-	if (getAddress(bindAddress, &iaddr) < 0) {
+	struct in_addr ibindaddr;
+	if (getAddress(bindAddress, &ibindaddr) < 0) {
 		fprintf(stderr, "rinetd: host %s could not be resolved.\n",
 			bindAddress);
 		exit(1);
@@ -266,159 +573,542 @@ void addServer(char *bindAddress, int bindPort, int bindProto,
 			sourceAddress);
 		exit(1);
 	}
-	/* Make a server socket */
-	SOCKET fd = socket(PF_INET,
-	                   bindProto == protoTcp ? SOCK_STREAM : SOCK_DGRAM,
-	                   bindProto == protoTcp ? IPPROTO_TCP : IPPROTO_UDP);
-	if (fd == INVALID_SOCKET) {
-		syslog(LOG_ERR, "couldn't create "
-			"server socket! (%m)\n");
+	/* Allocate server info. Sockets are created later by each
+		worker, see openServers(). */
+	allServers = (ServerInfo *)
+		realloc(allServers, sizeof(ServerInfo) * (allServersCount + 1));
+	if (!allServers) {
 		exit(1);
 	}
-	struct sockaddr_in saddr;
-	saddr.sin_family = AF_INET;
-	memcpy(&saddr.sin_addr, &iaddr, sizeof(iaddr));
-	saddr.sin_port = htons(bindPort);
-	int tmp = 1;
-	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
-		(const char *) &tmp, sizeof(tmp));
-	if (bind(fd, (struct sockaddr *)
-		&saddr, sizeof(saddr)) == SOCKET_ERROR) {
-		/* Warn -- don't exit. */
-		syslog(LOG_ERR, "couldn't bind to "
-			"address %s port %d (%m)\n",
-			bindAddress, bindPort);
-		closesocket(fd);
+	ServerInfo *srv = &allServers[allServersCount];
+	memset(srv, 0, sizeof(*srv));
+	srv->fd = INVALID_SOCKET;
+	srv->bindAddr = ibindaddr;
+	srv->fromHost = bindAddress;
+	if (!srv->fromHost) {
 		exit(1);
 	}
+	srv->fromPort = bindPort;
+	srv->fromProto = bindProto;
+	srv->sourceAddr = isourceaddr;
+	srv->toProto = connectProto;
+	srv->serverTimeout = serverTimeout;
+	srv->udpBatch = udpBatch;
+	srv->bufferMin = bufferMin;
+	srv->bufferMax = bufferMax;
+	srv->balance = balance;
+	++allServersCount;
+	addBackend(connectAddress, connectPort, connectProto, weight);
+}
 
-	if (bindProto == protoTcp) {
-		if (listen(fd, RINETD_LISTEN_BACKLOG) == SOCKET_ERROR) {
-			/* Warn -- don't exit. */
-			syslog(LOG_ERR, "couldn't listen to "
-				"address %s port %d (%m)\n",
-				bindAddress, bindPort);
-			closesocket(fd);
-		}
-
-		/* Make socket nonblocking in TCP mode only, otherwise
-			we may miss some data. */
-		setSocketDefaults(fd);
+void addBackend(char *connectAddress, int connectPort, int connectProto,
+                int weight)
+{
+	if (!connectAddress) {
+		exit(1);
 	}
-
+	struct in_addr iaddr;
 	if (getAddress(connectAddress, &iaddr) < 0) {
-		/* Warn -- don't exit. */
 		syslog(LOG_ERR, "host %s could not be resolved.\n",
+			connectAddress);
+		exit(1);
+	}
+	ServerInfo *srv = &allServers[allServersCount - 1];
+	if (connectProto != srv->toProto) {
+		syslog(LOG_ERR, "backend %s:%d does not use the protocol of "
+			"its forwarding rule\n", connectAddress, connectPort);
+		exit(1);
+	}
+	srv->backends = (Backend *)realloc(srv->backends,
+		sizeof(Backend) * (srv->backendCount + 1));
+	if (!srv->backends) {
+		exit(1);
+	}
+	Backend *backend = &srv->backends[srv->backendCount++];
+	memset(backend, 0, sizeof(*backend));
+	backend->addr = iaddr;
+	backend->port = htons(connectPort);
+	backend->host = connectAddress;
+	backend->portNum = connectPort;
+	backend->weight = weight;
+	srv->toHost = srv->backends[0].host;
+	srv->toPort = srv->backends[0].portNum;
+}
+
+void addStatsServer(char *bindAddress, int bindPort)
+{
+	struct in_addr ibindaddr;
+	if (getAddress(bindAddress, &ibindaddr) < 0) {
+		fprintf(stderr, "rinetd: host %s could not be resolved.\n",
 			bindAddress);
-		closesocket(fd);
 		exit(1);
 	}
-	/* Allocate server info */
+	free(statsServer.fromHost);
+	memset(&statsServer, 0, sizeof(statsServer));
+	statsServer.fd = INVALID_SOCKET;
+	statsServer.bindAddr = ibindaddr;
+	statsServer.fromHost = bindAddress;
+	statsServer.fromPort = bindPort;
+	statsServer.fromProto = protoTcp;
+	statsServer.toProto = protoTcp;
+	/* Requests are small, and so are buffers holding them */
+	statsServer.bufferMin = statsServer.bufferMax = RINETD_MIN_BUFFER_SIZE;
+	statsServer.statsListener = 1;
+}
+
+static void openServers(void)
+{
+	/* Copy the configuration, then make our own server sockets */
 	seInfo = (ServerInfo *)
-		realloc(seInfo, sizeof(ServerInfo) * (seTotal + 1));
+		malloc(sizeof(ServerInfo) * (allServersCount + 1));
 	if (!seInfo) {
 		exit(1);
 	}
-	ServerInfo *srv = &seInfo[seTotal];
-	memset(srv, 0, sizeof(*srv));
-	srv->fd = fd;
-	srv->localAddr = iaddr;
-	srv->localPort = htons(connectPort);
-	srv->fromHost = bindAddress;
-	if (!srv->fromHost) {
-		exit(1);
+	memcpy(seInfo, allServers, sizeof(ServerInfo) * allServersCount);
+	seTotal = allServersCount;
+	if (statsServer.fromHost && worker == &woInfo[0]) {
+		seInfo[seTotal++] = statsServer;
 	}
-	srv->fromPort = bindPort;
-	srv->fromProto = bindProto;
-	srv->sourceAddr = isourceaddr;
-	srv->toHost = connectAddress;
-	if (!srv->toHost) {
+	/* Counters of backends follow those of servers, so that they
+		are freed together */
+	int backendTotal = 0;
+	for (int i = 0; i < seTotal; ++i) {
+		backendTotal += seInfo[i].backendCount;
+	}
+	ServerCounters *counters = (ServerCounters *)
+		calloc(1, sizeof(ServerCounters) * (seTotal + 1)
+			+ sizeof(BackendCounters) * backendTotal);
+	if (!counters) {
 		exit(1);
 	}
-	srv->toPort = connectPort;
-	srv->toProto = connectProto;
-	srv->serverTimeout = serverTimeout;
+	BackendCounters *backendCounters =
+		(BackendCounters *)(counters + seTotal + 1);
+	worker->serverCount = seTotal;
+	__atomic_store_n(&worker->serverCounters, counters, __ATOMIC_RELEASE);
+	addFlights();
+	if (statsFileName) {
+		timerSet(&worker->segmentTimer, time(NULL) + 1);
+	}
+
+	for (int i = 0; i < seTotal; ++i) {
+		ServerInfo *srv = &seInfo[i];
+		srv->counters = &counters[i];
+		counters[i].backends = backendCounters;
+		backendCounters += srv->backendCount;
+		srv->balancer = NULL;
+		if (srv->backendCount) {
+			srv->balancer = balanceOpen(srv, (unsigned)time(NULL)
+				+ (unsigned)(worker - woInfo) * 2654435761u);
+			if (!srv->balancer) {
+				exit(1);
+			}
+		}
+		SOCKET fd = socket(PF_INET,
+		                   srv->fromProto == protoTcp ? SOCK_STREAM : SOCK_DGRAM,
+		                   srv->fromProto == protoTcp ? IPPROTO_TCP : IPPROTO_UDP);
+		if (fd == INVALID_SOCKET) {
+			syslog(LOG_ERR, "couldn't create "
+				"server socket! (%m)\n");
+			exit(1);
+		}
+		struct sockaddr_in saddr;
+		saddr.sin_family = AF_INET;
+		memcpy(&saddr.sin_addr, &srv->bindAddr, sizeof(srv->bindAddr));
+		saddr.sin_port = htons(srv->fromPort);
+		int tmp = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR,
+			(const char *) &tmp, sizeof(tmp));
+#if HAVE_WORKERS
+		/* Every worker binds the same address, and the kernel
+			spreads new connections and datagrams among them. */
+		if (woTotal > 1) {
+			setsockopt(fd, SOL_SOCKET, SO_REUSEPORT,
+				(const char *) &tmp, sizeof(tmp));
+		}
+#endif
+		if (bind(fd, (struct sockaddr *)
+			&saddr, sizeof(saddr)) == SOCKET_ERROR) {
+			/* Warn -- don't exit. */
+			syslog(LOG_ERR, "couldn't bind to "
+				"address %s port %d (%m)\n",
+				srv->fromHost, srv->fromPort);
+			closesocket(fd);
+			exit(1);
+		}
+
+		if (srv->fromProto == protoTcp) {
+			if (listen(fd, RINETD_LISTEN_BACKLOG) == SOCKET_ERROR) {
+				/* Warn -- don't exit. */
+				syslog(LOG_ERR, "couldn't listen to "
+					"address %s port %d (%m)\n",
+					srv->fromHost, srv->fromPort);
+				closesocket(fd);
+				fd = INVALID_SOCKET;
+				continue;
+			}
+
+			/* Make socket nonblocking in TCP mode only, otherwise
+				we may miss some data. */
+			setSocketDefaults(fd);
+		}
+
+		srv->fd = fd;
 #ifndef _WIN32
-	if (fd > maxfd) {
-		maxfd = fd;
+		if (fd > maxfd) {
+			maxfd = fd;
+		}
+#endif
+	}
+
+	registerServers();
+	/* Backends are shared, so only one worker checks them */
+	if (worker == &woInfo[0]) {
+		healthOpen(watchProbe, closeProbe);
+	}
+}
+
+static void closeServers(void)
+{
+	/* Remove references to server information */
+	for (int i = 0; i < coTotal; ++i) {
+		ConnectionInfo *cnx = getConnection(i);
+		cnx->server = NULL;
+	}
+	/* Close existing server sockets. */
+	for (int i = 0; i < seTotal; ++i) {
+		ServerInfo *srv = &seInfo[i];
+		balanceClose(srv->balancer);
+		if (srv->fd != INVALID_SOCKET) {
+#if HAVE_URING
+			if (options.engine == engineUring) {
+				/* The pending accept holds a reference to the
+					socket, so stop listening right away to let
+					the new configuration bind the same port. */
+				shutdown(srv->fd, SHUT_RDWR);
+				uringClose(srv->fd);
+			} else
+#endif
+			closesocket(srv->fd);
+		}
+	}
+	if (worker == &woInfo[0]) {
+		healthClose();
+	}
+	/* Free memory associated with previous set. */
+	free(seInfo);
+	seInfo = NULL;
+	seTotal = 0;
+	timerCancel(&worker->segmentTimer);
+	/* Waiting for the reload is not work */
+	loopWoken = 0;
+	ServerCounters *counters = worker->serverCounters;
+	__atomic_store_n(&worker->serverCounters, NULL, __ATOMIC_RELEASE);
+	worker->serverCount = 0;
+	free(counters);
+}
+
+static ConnectionInfo *getConnection(int index)
+{
+	/* Segment k starts at index 8 * (2^k - 1) */
+	unsigned i = (unsigned)index + (1u << CO_FIRST_SEGMENT_BITS);
+#if defined __GNUC__
+	int k = 31 - CO_FIRST_SEGMENT_BITS - __builtin_clz(i);
+#else
+	int k = 0;
+	while (i >> (k + CO_FIRST_SEGMENT_BITS + 1)) {
+		++k;
 	}
 #endif
-	++seTotal;
+	return &coSegments[k][i - (1u << (k + CO_FIRST_SEGMENT_BITS))];
 }
 
-static void setConnectionCount(int newCount)
+static int addConnections(void)
 {
-	if (newCount == coTotal) {
-		return;
+	if (coSegmentCount == 31 - CO_FIRST_SEGMENT_BITS) {
+		return -1;
 	}
+	int count = 1 << (coSegmentCount + CO_FIRST_SEGMENT_BITS);
+	ConnectionInfo *segment = (ConnectionInfo *)
+		malloc(sizeof(ConnectionInfo) * count);
+	if (!segment) {
+		return -1;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		ConnectionInfo *cnx = &segment[i];
+		memset(cnx, 0, sizeof(*cnx));
+		cnx->local.fd = INVALID_SOCKET;
+		cnx->remote.fd = INVALID_SOCKET;
+		cnx->local.pipe[0] = cnx->local.pipe[1] = -1;
+		cnx->remote.pipe[0] = cnx->remote.pipe[1] = -1;
+		cnx->index = coTotal + i;
+		timerInit(&cnx->timer, handleTimeout, cnx);
+		cnx->nextFree = i + 1 < count ? &segment[i + 1] : coFree;
+	}
+
+	coSegments[coSegmentCount++] = segment;
+	coTotal += count;
+	worker->connectionSlots = coTotal;
+	coFree = segment;
+	addFlights();
+	return 0;
+}
 
-	for (int i = newCount; i < coTotal; ++i) {
-		if (coInfo[i].local.fd != INVALID_SOCKET) {
-			closesocket(coInfo[i].local.fd);
+/* Give flight recorder events to the segments that have none, when
+	they are added or when a reload turns the recorder on, so that
+	accepting a connection never allocates them. A segment that cannot
+	get them goes unrecorded. */
+static void addFlights(void)
+{
+	if (!flightEnabled()) {
+		return;
+	}
+	for (int k = 0; k < coSegmentCount; ++k) {
+		if (coFlights[k]) {
+			continue;
 		}
-		if (coInfo[i].remote.fd != INVALID_SOCKET) {
-			if (coInfo[i].remote.proto == protoTcp)
-				closesocket(coInfo[i].remote.fd);
+		int count = 1 << (k + CO_FIRST_SEGMENT_BITS);
+		FlightEvent *events = (FlightEvent *)
+			malloc(sizeof(FlightEvent) * flightEvents * count);
+		if (!events) {
+			continue;
+		}
+		coFlights[k] = events;
+		for (int i = 0; i < count; ++i) {
+			coSegments[k][i].flight = &events[i * flightEvents];
 		}
-		free(coInfo[i].local.buffer);
 	}
+}
 
-	if (newCount == 0) {
-		free(coInfo);
-		coInfo = NULL;
-		coTotal = 0;
-		return;
+static void freeConnections(void)
+{
+	for (int i = 0; i < coTotal; ++i) {
+		ConnectionInfo *cnx = getConnection(i);
+		timerCancel(&cnx->timer);
+		if (cnx->local.fd != INVALID_SOCKET) {
+			closesocket(cnx->local.fd);
+		}
+		if (cnx->remote.fd != INVALID_SOCKET) {
+			if (cnx->remote.proto == protoTcp)
+				closesocket(cnx->remote.fd);
+		}
 	}
+	freeBuffers();
+	while (coSegmentCount > 0) {
+		--coSegmentCount;
+		free(coFlights[coSegmentCount]);
+		coFlights[coSegmentCount] = NULL;
+		free(coSegments[coSegmentCount]);
+	}
+	coTotal = 0;
+	worker->connectionSlots = 0;
+	coFree = NULL;
+	free(udpHash);
+	udpHash = NULL;
+	udpHashSize = udpHashCount = 0;
+#if HAVE_MMSG
+	freeUdpBatch();
+#endif
+}
 
-	ConnectionInfo * newCoInfo = (ConnectionInfo *)
-		malloc(sizeof(ConnectionInfo) * newCount);
-	if (!newCoInfo) {
-		return;
+static ConnectionInfo *findAvailableConnection(void)
+{
+	/* Allocate new connections if none can be reused */
+	if (!coFree && addConnections() < 0) {
+		syslog(LOG_ERR, "not enough memory to add slots. "
+			"Currently %d slots.\n", coTotal);
+		return NULL;
 	}
+	ConnectionInfo *cnx = coFree;
+	coFree = cnx->nextFree;
+	return cnx;
+}
 
-	memcpy(newCoInfo, coInfo, sizeof(ConnectionInfo) * coTotal);
+static unsigned udpHashKey(SOCKET fd, struct sockaddr_in const *addr)
+{
+	unsigned key = (unsigned)addr->sin_addr.s_addr * 0x9e3779b1u;
+	key ^= ((unsigned)addr->sin_port << 16 | ((unsigned)fd & 0xffff))
+		* 0x85ebca6bu;
+	return key ^ key >> 16;
+}
 
-	for (int i = coTotal; i < newCount; ++i) {
-		ConnectionInfo *cnx = &newCoInfo[i];
-		memset(cnx, 0, sizeof(*cnx));
-		cnx->local.fd = INVALID_SOCKET;
-		cnx->remote.fd = INVALID_SOCKET;
-		cnx->local.buffer = (char *) malloc(sizeof(char) * 2 * RINETD_BUFFER_SIZE);
-		if (!cnx->local.buffer) {
-			while (i-- >= coTotal) {
-				free(newCoInfo[i].local.buffer);
+static ConnectionInfo *findUdpConnection(SOCKET fd, struct sockaddr_in const *addr)
+{
+	if (!udpHashCount) {
+		return NULL;
+	}
+	ConnectionInfo *cnx = udpHash[udpHashKey(fd, addr) & (udpHashSize - 1)];
+	for (; cnx; cnx = cnx->udpNext) {
+		if (cnx->remote.fd == fd
+			&& cnx->remoteAddress.sin_family == addr->sin_family
+			&& cnx->remoteAddress.sin_port == addr->sin_port
+			&& cnx->remoteAddress.sin_addr.s_addr == addr->sin_addr.s_addr) {
+			return cnx;
+		}
+	}
+	return NULL;
+}
+
+static void addUdpConnection(ConnectionInfo *cnx)
+{
+	/* Keep at most one connection per bucket on average */
+	if (udpHashCount >= udpHashSize) {
+		unsigned newSize = udpHashSize ? udpHashSize * 2 : 64;
+		ConnectionInfo **newHash = (ConnectionInfo **)
+			calloc(newSize, sizeof(ConnectionInfo *));
+		if (newHash) {
+			for (unsigned i = 0; i < udpHashSize; ++i) {
+				while (udpHash[i]) {
+					ConnectionInfo *moved = udpHash[i];
+					udpHash[i] = moved->udpNext;
+					unsigned bucket = udpHashKey(moved->remote.fd,
+						&moved->remoteAddress) & (newSize - 1);
+					moved->udpNext = newHash[bucket];
+					newHash[bucket] = moved;
+				}
 			}
-			free(newCoInfo);
+			free(udpHash);
+			udpHash = newHash;
+			udpHashSize = newSize;
+		} else if (!udpHashSize) {
+			syslog(LOG_ERR, "not enough memory to index UDP connections.\n");
+			cnx->udpNext = cnx;
 			return;
 		}
-		cnx->remote.buffer = cnx->local.buffer + RINETD_BUFFER_SIZE;
 	}
 
-	free(coInfo);
-	coInfo = newCoInfo;
-	coTotal = newCount;
+	unsigned bucket = udpHashKey(cnx->remote.fd, &cnx->remoteAddress)
+		& (udpHashSize - 1);
+	cnx->udpNext = udpHash[bucket];
+	udpHash[bucket] = cnx;
+	++udpHashCount;
 }
 
-static ConnectionInfo *findAvailableConnection(void)
+static void removeUdpConnection(ConnectionInfo *cnx)
+{
+	/* Connections that could not be indexed point to themselves */
+	if (cnx->udpNext == cnx) {
+		cnx->udpNext = NULL;
+		return;
+	}
+	ConnectionInfo **prev = &udpHash[udpHashKey(cnx->remote.fd,
+		&cnx->remoteAddress) & (udpHashSize - 1)];
+	for (; *prev; prev = &(*prev)->udpNext) {
+		if (*prev == cnx) {
+			*prev = cnx->udpNext;
+			cnx->udpNext = NULL;
+			--udpHashCount;
+			return;
+		}
+	}
+}
+
+/* Only call this once both sockets are closed and no io_uring
+	operation may still write to the buffers. */
+static void releaseConnection(ConnectionInfo *cnx)
 {
-	/* Find an existing closed connection to reuse */
-	for (int j = 0; j < coTotal; ++j) {
-		if (coInfo[j].local.fd == INVALID_SOCKET
-			&& coInfo[j].remote.fd == INVALID_SOCKET) {
-			return &coInfo[j];
+	freeBuffer(&cnx->local);
+	freeBuffer(&cnx->remote);
+	if (cnx->server) {
+		--cnx->server->counters->connections;
+		if (cnx->slot >= 0) {
+			balanceRelease(cnx->server, cnx->slot);
+			if (cnx->coFailed) {
+				balanceFailed(cnx->server, cnx->slot);
+			}
+		}
+		if (cnx->coForwarded) {
+			long long duration = logClock() - cnx->openedTime;
+			histogramRecord(&cnx->server->counters->duration, duration);
+			if (cnx->coSlow) {
+				flightDump(cnx, (int)(worker - woInfo), "slow");
+			} else if (flightDuration
+				&& duration >= flightDuration * 1000LL) {
+				flightDump(cnx, (int)(worker - woInfo), "long");
+			}
 		}
 	}
+	cnx->nextFree = coFree;
+	coFree = cnx;
+}
 
-	/* Allocate new connections and pick the first one */
-	int oldTotal = coTotal;
-	setConnectionCount(coTotal * 4 / 3 + 8);
-	if (coTotal == oldTotal) {
-		syslog(LOG_ERR, "not enough memory to add slots. "
-			"Currently %d slots.\n", coTotal);
-		/* Go back to the previous total number of slots */
-		return NULL;
+static void eventPass(void)
+{
+	++worker->loopCount;
+	timerRun(time(NULL));
+	if (options.engine == engineUring) {
+		uringPass();
+	} else if (options.engine == engineEpoll) {
+		epollPass();
+	} else {
+		selectPass();
+	}
+#if HAVE_MMSG
+	flushUdpReplies();
+#endif
+	setPhase(phaseLog);
+	logPass();
+	if (__atomic_exchange_n(&worker->flightDumpRequested, 0,
+			__ATOMIC_ACQ_REL)) {
+		flightDumpConnections();
+	}
+}
+
+/* Called by each engine right before waiting for events. Returns the
+	time, and tells the watchdog that the event loop is not stuck. */
+static long long loopWaiting(void)
+{
+	long long now = watchdogClock();
+	/* Tell how long the last stall reported by the watchdog lasted */
+	int stalled = __atomic_exchange_n(&worker->stalled, 0, __ATOMIC_RELAXED);
+	if (stalled) {
+		syslog(LOG_ERR, "worker %d: event loop was blocked for %lld ms "
+			"while %s\n", (int)(worker - woInfo),
+			(now - worker->busySince) / 1000,
+			watchdogPhaseName(stalled - 1));
+	}
+	__atomic_store_n(&worker->busySince, 0, __ATOMIC_RELAXED);
+	return now;
+}
+
+/* Called by each engine after waiting for events, with the time it
+	started to wait. The time since the previous wait ended is the work
+	done in between: handling events and timers, and writing logs. */
+static void loopWaited(long long before, int watched, int ready)
+{
+	long long now = watchdogClock();
+	setPhase(phaseRelay);
+	__atomic_store_n(&worker->busySince, now, __ATOMIC_RELAXED);
+	if (loopWoken) {
+		histogramRecord(&worker->workTime, before - loopWoken);
+	}
+	histogramRecord(&worker->waitTime, now - before);
+	loopWoken = now;
+	worker->watchedCount += (unsigned)watched;
+	worker->readyCount += ready > 0 ? (unsigned)ready : 0;
+}
+
+/* Tell the watchdog what the event loop is busy with. Returns the
+	previous phase, to restore it afterwards. */
+static int setPhase(int phase)
+{
+	if (!worker) {
+		/* Not started yet */
+		return phase;
+	}
+	int previous = worker->phase;
+	__atomic_store_n(&worker->phase, phase, __ATOMIC_RELAXED);
+	return previous;
+}
+
+/* Count a receive, send or accept call given what it returned */
+static void countCall(int kind, long got)
+{
+	++worker->callCount[kind];
+	if (got < 0 && (GetLastError() == WSAEWOULDBLOCK
+			|| GetLastError() == WSAEINPROGRESS)) {
+		++worker->blockedCount[kind];
 	}
-	return &coInfo[oldTotal];
 }
 
 static void selectPass(void)
@@ -434,68 +1124,87 @@ static void selectPass(void)
 #	define FD_ISSET_EXT(fd, ar) FD_ISSET((fd) % FD_SETSIZE, &(ar)[(fd) / FD_SETSIZE])
 #endif
 
-	/* Timeout value -- infinite by default */
+	/* Wait until the next timer expires, or forever if there are none */
 	struct timeval timeout;
-	timeout.tv_sec = timeout.tv_usec = 0;
-	time_t now = time(NULL);
+	long delay = timerNextExpiry(time(NULL));
+	timeout.tv_sec = delay;
+	timeout.tv_usec = 0;
 
 	fd_set readfds[fdSetCount], writefds[fdSetCount];
 	FD_ZERO_EXT(readfds);
 	FD_ZERO_EXT(writefds);
+	int watched = 0;
 	/* Server sockets */
 	for (int i = 0; i < seTotal; ++i) {
 		if (seInfo[i].fd != INVALID_SOCKET) {
 			FD_SET_EXT(seInfo[i].fd, readfds);
+			++watched;
+		}
+	}
+	/* Health check sockets */
+	for (int i = 0; i < healthCount(); ++i) {
+		int writable;
+		SOCKET fd = healthSocket(i, &writable);
+		if (fd != INVALID_SOCKET) {
+			FD_SET_EXT(fd, writable ? writefds : readfds);
+			++watched;
 		}
 	}
 	/* Connection sockets */
 	for (int i = 0; i < coTotal; ++i) {
-		ConnectionInfo *cnx = &coInfo[i];
+		ConnectionInfo *cnx = getConnection(i);
 		if (cnx->local.fd != INVALID_SOCKET) {
 			/* Accept more output from the local
 				server if there's room */
-			if (cnx->local.recvPos < RINETD_BUFFER_SIZE) {
+			if (cnx->local.recvPos - cnx->remote.sentPos
+				< bufferCapacity(&cnx->local)) {
 				FD_SET_EXT(cnx->local.fd, readfds);
+				++watched;
 			}
 			/* Send more input to the local server
-				if we have any, or if we’re closing */
-			if (cnx->local.sentPos < cnx->remote.recvPos || cnx->coClosing) {
+				if we have any, or if we’re closing, and
+				see when the connection is made */
+			if (cnx->local.sentPos < cnx->remote.recvPos || cnx->coClosing
+				|| cnx->coConnecting) {
 				FD_SET_EXT(cnx->local.fd, writefds);
+				++watched;
 			}
 		}
 		if (cnx->remote.fd != INVALID_SOCKET) {
 			/* Get more input if we have room for it */
-			if (cnx->remote.recvPos < RINETD_BUFFER_SIZE) {
+			if (cnx->remote.recvPos - cnx->local.sentPos
+				< bufferCapacity(&cnx->remote)) {
 				FD_SET_EXT(cnx->remote.fd, readfds);
-				/* For UDP connections, we need to handle timeouts */
-				if (cnx->remote.proto == protoUdp) {
-					long delay = (long)(cnx->remoteTimeout - now);
-					timeout.tv_sec = delay <= 1 ? 1
-						: (delay < timeout.tv_sec || timeout.tv_sec == 0) ? delay
-						: timeout.tv_sec;
-				}
+				++watched;
 			}
 			/* Send more output if we have any, or if we’re closing */
 			if (cnx->remote.sentPos < cnx->local.recvPos || cnx->coClosing) {
 				FD_SET_EXT(cnx->remote.fd, writefds);
+				++watched;
 			}
 		}
 	}
 
-	select(maxfd + 1, readfds, writefds, 0, timeout.tv_sec ? &timeout : NULL);
+	long long before = loopWaiting();
+	int ready = select(maxfd + 1, readfds, writefds, 0,
+		delay >= 0 ? &timeout : NULL);
+	++worker->syscallCount;
+	loopWaited(before, watched, ready);
+	if (ready < 0) {
+		/* Interrupted by a signal, the sets are meaningless */
+		return;
+	}
 	for (int i = 0; i < coTotal; ++i) {
-		ConnectionInfo *cnx = &coInfo[i];
+		ConnectionInfo *cnx = getConnection(i);
+		/* A retry may reopen the local socket with the same descriptor,
+			which was not part of this select() */
+		int retries = cnx->retries;
 		if (cnx->remote.fd != INVALID_SOCKET) {
-			/* Do not read on remote UDP sockets, the server does it,
-				but handle timeouts instead. */
+			/* Do not read on remote UDP sockets, the server does it */
 			if (cnx->remote.proto == protoTcp) {
 				if (FD_ISSET_EXT(cnx->remote.fd, readfds)) {
 					handleRead(cnx, &cnx->remote, &cnx->local);
 				}
-			} else {
-				if (now > cnx->remoteTimeout) {
-					handleClose(cnx, &cnx->remote, &cnx->local);
-				}
 			}
 		}
 		if (cnx->remote.fd != INVALID_SOCKET) {
@@ -508,12 +1217,22 @@ static void selectPass(void)
 				handleRead(cnx, &cnx->local, &cnx->remote);
 			}
 		}
-		if (cnx->local.fd != INVALID_SOCKET) {
+		if (cnx->local.fd != INVALID_SOCKET && cnx->retries == retries) {
 			if (FD_ISSET_EXT(cnx->local.fd, writefds)) {
 				handleWrite(cnx, &cnx->local, &cnx->remote);
 			}
 		}
 	}
+	/* Probes started since the select() were not part of it, but
+		healthReady() never blocks */
+	for (int i = 0; i < healthCount(); ++i) {
+		int writable;
+		SOCKET fd = healthSocket(i, &writable);
+		if (fd != INVALID_SOCKET
+			&& FD_ISSET_EXT(fd, writable ? writefds : readfds)) {
+			healthReady(i);
+		}
+	}
 	/* Handle servers last because handleAccept() may modify coTotal */
 	for (int i = 0; i < seTotal; ++i) {
 		ServerInfo *srv = &seInfo[i];
@@ -525,18 +1244,670 @@ static void selectPass(void)
 	}
 }
 
-static void handleRead(ConnectionInfo *cnx, Socket *socket, Socket *other_socket)
+static void registerServers(void)
 {
-	if (RINETD_BUFFER_SIZE == socket->recvPos) {
+#if HAVE_URING
+	if (options.engine == engineUring) {
+		for (int i = 0; i < seTotal; ++i) {
+			if (seInfo[i].fd != INVALID_SOCKET) {
+				uringArmServer(i);
+			}
+		}
 		return;
 	}
-	int got = recv(socket->fd, socket->buffer + socket->recvPos,
-		RINETD_BUFFER_SIZE - socket->recvPos, 0);
-	if (got < 0) {
-		if (GetLastError() == WSAEWOULDBLOCK) {
-			return;
-		}
-		if (GetLastError() == WSAEINPROGRESS) {
+#endif
+#if HAVE_EPOLL
+	if (options.engine != engineEpoll) {
+		return;
+	}
+	for (int i = 0; i < seTotal; ++i) {
+		ServerInfo *srv = &seInfo[i];
+		if (srv->fd != INVALID_SOCKET) {
+			struct epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.u64 = (uint64_t)(unsigned)srv->fd << 32
+				| EPOLL_SERVER_TAG | (unsigned)i;
+			++worker->syscallCount;
+			if (epoll_ctl(epollFd, EPOLL_CTL_ADD, srv->fd, &ev) < 0) {
+				syslog(LOG_ERR, "epoll_ctl(%d): %m\n", srv->fd);
+			}
+		}
+	}
+#endif
+}
+
+#if HAVE_EPOLL
+static void setInterest(ConnectionInfo const *cnx, Socket *socket,
+                        Socket const *other_socket, unsigned tag)
+{
+	if (socket->fd == INVALID_SOCKET) {
+		/* Closing the socket already removed it from the epoll set */
+		socket->interest = 0;
+		return;
+	}
+
+	/* Same rules as in selectPass(), except that the remote socket
+		of a UDP connection is the server socket, which is read by
+		handleAccept() and never registered here. */
+	int events = 0;
+	if (socket->proto == protoTcp || socket == &cnx->local) {
+		if (socket->recvPos - other_socket->sentPos
+			< bufferCapacity(socket)) {
+			events |= EPOLLIN;
+		}
+		if (socket->sentPos < other_socket->recvPos || cnx->coClosing
+			|| (cnx->coConnecting && socket == &cnx->local)) {
+			events |= EPOLLOUT;
+		}
+	}
+	if (events == socket->interest) {
+		return;
+	}
+
+	struct epoll_event ev;
+	ev.events = events;
+	ev.data.u64 = (uint64_t)(unsigned)socket->fd << 32 | tag;
+	int op = !socket->interest ? EPOLL_CTL_ADD
+		: !events ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+	++worker->syscallCount;
+	if (epoll_ctl(epollFd, op, socket->fd, &ev) < 0) {
+		syslog(LOG_ERR, "epoll_ctl(%d): %m\n", socket->fd);
+	}
+	epollWatched += op == EPOLL_CTL_ADD ? 1 : op == EPOLL_CTL_DEL ? -1 : 0;
+	socket->interest = events;
+}
+#endif
+
+#if HAVE_URING
+static struct io_uring_sqe *getSqe(void)
+{
+	struct io_uring_sqe *sqe;
+	while (!(sqe = uringGetSqe())) {
+		/* The submission queue is full, flush it */
+		int calls = uringEnter(0);
+		if (calls < 0) {
+			syslog(LOG_ERR, "io_uring_enter(): %m\n");
+			continue;
+		}
+		worker->syscallCount += calls;
+	}
+	++uringInFlight;
+	return sqe;
+}
+
+static void uringArmServer(int index)
+{
+	ServerInfo const *srv = &seInfo[index];
+	struct io_uring_sqe *sqe = getSqe();
+	sqe->fd = srv->fd;
+	if (srv->fromProto == protoTcp) {
+		/* One submission keeps accepting until it fails */
+		sqe->opcode = IORING_OP_ACCEPT;
+		sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+		sqe->user_data = URING_DATA(srv->fd, uringAccept, index);
+	} else /* if (srv->fromProto == protoUdp) */ {
+		/* handleAccept() reads one datagram per notification, so
+			use a one-shot poll that is re-armed afterwards. */
+		sqe->opcode = IORING_OP_POLL_ADD;
+#	if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		sqe->poll32_events = POLLIN << 16;
+#	else
+		sqe->poll32_events = POLLIN;
+#	endif
+		sqe->user_data = URING_DATA(srv->fd, uringPoll, index);
+	}
+}
+
+/* Cancel all operations on a socket, then close it. Closing the file
+	descriptor alone would not release the socket while they are
+	pending. */
+static void uringClose(SOCKET fd)
+{
+	struct io_uring_sqe *sqe = getSqe();
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = fd;
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+	sqe->flags = IOSQE_IO_HARDLINK;
+	sqe->user_data = URING_DATA(fd, uringIgnore, 0);
+	sqe = getSqe();
+	sqe->opcode = IORING_OP_CLOSE;
+	sqe->fd = fd;
+	sqe->user_data = URING_DATA(fd, uringIgnore, 0);
+}
+
+static void uringArm(ConnectionInfo *cnx, Socket *socket,
+                     Socket *other_socket, unsigned tag)
+{
+	/* Same rules as for epoll */
+	if (socket->fd == INVALID_SOCKET
+		|| (socket->proto == protoUdp && socket == &cnx->remote)) {
+		return;
+	}
+
+	/* Nothing is sent before the local server accepts, so that
+		another one can be tried if it does not */
+	if (!(socket->pending & uringSend)
+		&& !(cnx->coConnecting && socket == &cnx->local)) {
+		if (socket->sentPos < other_socket->recvPos) {
+			struct io_uring_sqe *sqe = getSqe();
+			sqe->opcode = IORING_OP_WRITEV;
+			sqe->fd = socket->fd;
+			sqe->addr = (uintptr_t)socket->sendVectors;
+			sqe->len = getSendVectors(socket, other_socket,
+				socket->sendVectors);
+			sqe->user_data = URING_DATA(socket->fd, uringSend, tag);
+			socket->pending |= uringSend;
+		} else if (cnx->coClosing) {
+			/* Everything was sent, so log and close */
+			handleWrite(cnx, socket, other_socket);
+			return;
+		}
+	}
+
+	/* Receives write straight into the buffer, so it can only
+		be rewound, and given back, while none is in flight. */
+	if (!(socket->pending & uringRecv)
+		&& other_socket->sentPos == socket->recvPos) {
+		other_socket->sentPos = socket->recvPos = 0;
+		freeBuffer(socket);
+	}
+	if (!(socket->pending & (uringRecv | uringReadable))) {
+		if (socket->buffer && !(other_socket->pending & uringSend)) {
+			resizeBuffer(cnx, socket, other_socket);
+		}
+		if (socket->recvPos - other_socket->sentPos == socket->bufferSize) {
+			/* Wait for the other side to make room */
+		} else if (!socket->buffer || socket->recvPos > 0) {
+			/* Wait for data before taking a buffer again. A receive
+				would also pin a buffer that still holds data, which
+				could then never be rewound and given back. */
+			struct io_uring_sqe *sqe = getSqe();
+			sqe->opcode = IORING_OP_POLL_ADD;
+			sqe->fd = socket->fd;
+			/* Also see when the connection is made */
+			unsigned events = POLLIN;
+			if (cnx->coConnecting && socket == &cnx->local) {
+				events |= POLLOUT;
+			}
+#	if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+			sqe->poll32_events = events << 16;
+#	else
+			sqe->poll32_events = events;
+#	endif
+			sqe->user_data = URING_DATA(socket->fd, uringReadable, tag);
+			socket->pending |= uringReadable;
+		} else {
+			uringArmRecv(socket, other_socket, tag);
+		}
+	}
+}
+
+static void uringArmRecv(Socket *socket, Socket const *other_socket,
+                         unsigned tag)
+{
+	struct io_uring_sqe *sqe = getSqe();
+	sqe->opcode = IORING_OP_READV;
+	sqe->fd = socket->fd;
+	sqe->addr = (uintptr_t)socket->recvVectors;
+	sqe->len = getRecvVectors(socket, other_socket, socket->recvVectors);
+	sqe->user_data = URING_DATA(socket->fd, uringRecv, tag);
+	socket->pending |= uringRecv;
+}
+#endif
+
+static void updateInterest(ConnectionInfo *cnx)
+{
+	if (options.engine == engineSelect) {
+		return;
+	}
+	/* Nothing tells us when the shared server socket of a UDP
+		connection becomes writable for this connection, so send
+		pending data right away. */
+	if (cnx->remote.fd != INVALID_SOCKET && cnx->remote.proto == protoUdp
+		&& (cnx->remote.sentPos < cnx->local.recvPos || cnx->coClosing)) {
+		handleWrite(cnx, &cnx->remote, &cnx->local);
+	}
+#if HAVE_URING
+	if (options.engine == engineUring) {
+		unsigned index = (unsigned)cnx->index;
+		uringArm(cnx, &cnx->remote, &cnx->local, index * 2);
+		uringArm(cnx, &cnx->local, &cnx->remote, index * 2 + 1);
+		return;
+	}
+#endif
+#if HAVE_EPOLL
+	unsigned index = (unsigned)cnx->index;
+	setInterest(cnx, &cnx->remote, &cnx->local, index * 2);
+	setInterest(cnx, &cnx->local, &cnx->remote, index * 2 + 1);
+#endif
+}
+
+static void handleTimeout(Timer *timer)
+{
+	ConnectionInfo *cnx = (ConnectionInfo *)timer->data;
+	/* The local server took too long to accept, see openConnection() */
+	if (cnx->coConnecting) {
+		cnx->coConnecting = 0;
+		connectFailed(cnx, WSAETIMEDOUT);
+		handleClose(cnx, &cnx->local, &cnx->remote);
+		updateInterest(cnx);
+		return;
+	}
+	if (cnx->remote.fd == INVALID_SOCKET || cnx->remote.proto != protoUdp) {
+		return;
+	}
+	/* Datagrams only push remoteTimeout back, so that they do not
+		have to touch the timer, which now needs to catch up. */
+	if (time(NULL) <= cnx->remoteTimeout) {
+		timerSet(timer, cnx->remoteTimeout + 1);
+		return;
+	}
+	handleClose(cnx, &cnx->remote, &cnx->local);
+	updateInterest(cnx);
+}
+
+/* Health checks run from the timers of the first worker, and watch
+	their sockets through its engine, see health.h */
+static void watchProbe(SOCKET fd, int probe, int writable)
+{
+#ifndef _WIN32
+	if (fd > maxfd) {
+		maxfd = fd;
+	}
+#endif
+#if HAVE_URING
+	if (options.engine == engineUring) {
+		struct io_uring_sqe *sqe = getSqe();
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = fd;
+#	if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		sqe->poll32_events = (writable ? POLLOUT : POLLIN) << 16;
+#	else
+		sqe->poll32_events = writable ? POLLOUT : POLLIN;
+#	endif
+		sqe->user_data = URING_DATA(fd, uringProbe, probe);
+		return;
+	}
+#endif
+#if HAVE_EPOLL
+	if (options.engine == engineEpoll) {
+		struct epoll_event ev;
+		ev.events = writable ? EPOLLOUT : EPOLLIN;
+		ev.data.u64 = (uint64_t)(unsigned)fd << 32
+			| EPOLL_PROBE_TAG | (unsigned)probe;
+		++worker->syscallCount;
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+			syslog(LOG_ERR, "epoll_ctl(%d): %m\n", fd);
+		}
+	}
+#endif
+	(void)probe;
+	(void)writable;
+}
+
+static void closeProbe(SOCKET fd)
+{
+#if HAVE_URING
+	if (options.engine == engineUring) {
+		uringClose(fd);
+		return;
+	}
+#endif
+	closesocket(fd);
+}
+
+static void epollPass(void)
+{
+#if HAVE_EPOLL
+	struct epoll_event events[RINETD_EPOLL_EVENTS];
+	long delay = timerNextExpiry(time(NULL));
+	long long before = loopWaiting();
+	int count = epoll_wait(epollFd, events, RINETD_EPOLL_EVENTS,
+		delay < 0 ? -1 : delay < 86400 ? (int)delay * 1000 : 86400000);
+	++worker->syscallCount;
+	loopWaited(before, epollWatched + seTotal, count);
+
+	for (int i = 0; i < count; ++i) {
+		SOCKET fd = (SOCKET)(events[i].data.u64 >> 32);
+		unsigned tag = (unsigned)events[i].data.u64;
+
+		/* Events may refer to sockets that were closed earlier in
+			this pass, so make sure the descriptor still matches. */
+		if (tag & EPOLL_SERVER_TAG) {
+			int index = (int)(tag & ~EPOLL_SERVER_TAG);
+			if (index >= seTotal || seInfo[index].fd != fd) {
+				continue;
+			}
+			ServerInfo *srv = &seInfo[index];
+#	if HAVE_MMSG
+			/* Writable again, flushUdpReplies() retries at the end
+				of this pass */
+			if (srv->udpBlocked && (events[i].events & EPOLLOUT)) {
+				struct epoll_event ev = events[i];
+				ev.events = EPOLLIN;
+				++worker->syscallCount;
+				if (epoll_ctl(epollFd, EPOLL_CTL_MOD, fd, &ev) < 0) {
+					syslog(LOG_ERR, "epoll_ctl(%d): %m\n", fd);
+				}
+				srv->udpBlocked = 0;
+			}
+#	endif
+			if (events[i].events & ~EPOLLOUT) {
+				handleAccept(srv);
+			}
+			continue;
+		}
+		if (tag & EPOLL_PROBE_TAG) {
+			int writable, index = (int)(tag & ~EPOLL_PROBE_TAG);
+			if (healthSocket(index, &writable) == fd) {
+				healthReady(index);
+			}
+			continue;
+		}
+
+		int index = (int)(tag / 2);
+		if (index >= coTotal) {
+			continue;
+		}
+		ConnectionInfo *cnx = getConnection(index);
+		Socket *socket = tag & 1 ? &cnx->local : &cnx->remote;
+		Socket *other_socket = tag & 1 ? &cnx->remote : &cnx->local;
+		if (socket->fd != fd) {
+			continue;
+		}
+
+		/* Let errors and hangups be reported by the handlers */
+		int ready = events[i].events;
+		if (ready & (EPOLLERR | EPOLLHUP)) {
+			ready |= socket->interest;
+		}
+		/* A retry may reopen the local socket, see selectPass() */
+		int retries = cnx->retries;
+		if (ready & EPOLLIN) {
+			handleRead(cnx, socket, other_socket);
+		}
+		if ((ready & EPOLLOUT) && socket->fd != INVALID_SOCKET
+			&& cnx->retries == retries) {
+			handleWrite(cnx, socket, other_socket);
+		}
+		updateInterest(cnx);
+	}
+#endif
+}
+
+static void uringPass(void)
+{
+#if HAVE_URING
+	/* Wake up when the next timer expires. A timeout already in flight
+		is left alone unless it would fire too late. */
+	time_t now = time(NULL);
+	long delay = timerNextExpiry(now);
+	if (delay > 0 && (!uringTimerDeadline
+			|| now + delay < uringTimerDeadline)) {
+		uringTimerDelay.tv_sec = delay;
+		uringTimerDelay.tv_nsec = 0;
+		struct io_uring_sqe *sqe = getSqe();
+		sqe->opcode = IORING_OP_TIMEOUT;
+		sqe->addr = (uintptr_t)&uringTimerDelay;
+		sqe->len = 1;
+		sqe->user_data = URING_DATA(0, uringTimeout,
+			++uringTimerGeneration & 0xfffffff);
+		uringTimerDeadline = now + delay;
+	}
+
+	/* Submit everything queued since the last pass and wait */
+	long long before = loopWaiting();
+	int watched = uringInFlight;
+	int calls = uringEnter(delay != 0);
+	loopWaited(before, watched, 0);
+	if (calls < 0) {
+		++worker->syscallCount;
+		if (errno != EINTR) {
+			syslog(LOG_ERR, "io_uring_enter(): %m\n");
+		}
+	} else {
+		worker->syscallCount += calls;
+	}
+
+	UringCompletion cqe;
+	int ready = 0;
+	while (uringPeek(&cqe)) {
+		SOCKET fd = (SOCKET)(cqe.data >> 32);
+		unsigned op = (unsigned)(cqe.data >> 28) & 0xf;
+		unsigned tag = (unsigned)cqe.data & 0xfffffff;
+		if (!(cqe.flags & IORING_CQE_F_MORE)) {
+			--uringInFlight;
+		}
+		++ready;
+
+		if (op == uringTimeout) {
+			if (tag == (uringTimerGeneration & 0xfffffff)) {
+				uringTimerDeadline = 0;
+			}
+			continue;
+		}
+
+		if (op == uringProbe) {
+			/* Polls are cancelled when probes finish early, and
+				only fire once otherwise */
+			int writable, index = (int)tag;
+			if (cqe.res >= 0 && healthSocket(index, &writable) == fd
+				&& healthReady(index)) {
+				watchProbe(fd, index, writable);
+			}
+			continue;
+		}
+
+		if (op == uringWritable) {
+			/* flushUdpReplies() retries at the end of this pass */
+			int index = (int)tag;
+			if (index < seTotal && seInfo[index].fd == fd) {
+				seInfo[index].udpBlocked = 0;
+			}
+			continue;
+		}
+
+		if (op == uringAccept || op == uringPoll) {
+			/* Server sockets may have been closed by a reload */
+			int index = (int)tag;
+			if (index >= seTotal || seInfo[index].fd != fd) {
+				if (op == uringAccept && cqe.res >= 0) {
+					closesocket(cqe.res);
+				}
+				continue;
+			}
+			ServerInfo *srv = &seInfo[index];
+			if (op == uringPoll) {
+				if (cqe.res >= 0) {
+					handleAccept(srv);
+				}
+				uringArmServer(index);
+				continue;
+			}
+			if (!(cqe.flags & IORING_CQE_F_MORE)) {
+				uringArmServer(index);
+			}
+			PROBE2(accept, -1, index);
+			++worker->callCount[callAccept];
+			if (cqe.res < 0) {
+				errno = -cqe.res;
+				syslog(LOG_ERR, "accept(%d): %m\n", srv->fd);
+				logEvent(NULL, srv, logAcceptFailed);
+				continue;
+			}
+			/* A multishot accept shares its address buffer between
+				all completions, so ask for the address instead. */
+			struct sockaddr addr;
+			SOCKLEN_T addrlen = sizeof(addr);
+			++worker->syscallCount;
+			if (getpeername(cqe.res, &addr, &addrlen) == SOCKET_ERROR) {
+				closesocket(cqe.res);
+				continue;
+			}
+			setSocketDefaults(cqe.res);
+			setPhase(phaseAccept);
+			openConnection(srv, cqe.res, &addr, NULL, 0);
+			setPhase(phaseRelay);
+			continue;
+		}
+
+		if (op != uringRecv && op != uringSend && op != uringReadable) {
+			continue;
+		}
+
+		int index = (int)(tag / 2);
+		if (index >= coTotal) {
+			continue;
+		}
+		ConnectionInfo *cnx = getConnection(index);
+		Socket *socket = tag & 1 ? &cnx->local : &cnx->remote;
+		Socket *other_socket = tag & 1 ? &cnx->remote : &cnx->local;
+		socket->pending &= ~op;
+		if (socket->fd != fd) {
+			/* Cancelled or completed after the socket was closed */
+			if (cnx->local.fd == INVALID_SOCKET
+				&& cnx->remote.fd == INVALID_SOCKET
+				&& !cnx->local.pending && !cnx->remote.pending) {
+				releaseConnection(cnx);
+			} else if (cnx->coRetrying && !cnx->local.pending
+				&& cnx->remote.fd != INVALID_SOCKET) {
+				/* Now connect to the next backend, unless a reload
+					closed the server meanwhile */
+				cnx->coRetrying = 0;
+				if (!cnx->server || (connectBackend(cnx) < 0
+					&& !retryConnection(cnx))) {
+					handleClose(cnx, &cnx->local, &cnx->remote);
+				}
+				updateInterest(cnx);
+			}
+			continue;
+		}
+
+		if (op != uringReadable) {
+			int kind = op == uringRecv ? callRecv : callSend;
+			++worker->callCount[kind];
+			if (cqe.res == -EAGAIN) {
+				++worker->blockedCount[kind];
+			}
+		}
+		if (cqe.res == -EAGAIN || cqe.res == -EINTR) {
+			/* Nothing happened, try again */
+		} else if (op == uringReadable) {
+			if (cnx->coConnecting && socket == &cnx->local) {
+				handleConnect(cnx);
+			}
+			/* Errors and hangups are reported by the receive */
+			if (socket->fd == INVALID_SOCKET || cqe.res == POLLOUT
+				|| cnx->coConnecting) {
+				/* Closed, only connected so far, or connecting
+					again to another backend */
+			} else if (socket->buffer || getBuffer(cnx, socket) == 0) {
+				uringArmRecv(socket, other_socket, tag);
+			} else {
+				closeUnbuffered(cnx, socket, other_socket);
+			}
+		} else if (op == uringRecv) {
+			PROBE4(read, cnx->index, ruleIndex(cnx->server),
+				socket == &cnx->local, cqe.res);
+			flightRecord(cnx, flightRead, socket == &cnx->local, cqe.res);
+			if (cqe.res <= 0) {
+				handleClose(cnx, socket, other_socket);
+			} else {
+				if (socket == &cnx->local && !socket->recvBytes
+					&& cnx->server) {
+					recordLatency(cnx,
+						&cnx->server->counters->firstByteTime);
+					balanceSucceeded(cnx->server, cnx->slot);
+				}
+				socket->recvBytes += cqe.res;
+				socket->recvPos += cqe.res;
+				if (socket == &cnx->remote && cnx->server) {
+					cnx->server->counters->bytesIn += cqe.res;
+				}
+				if (cnx->coStats) {
+					handleStatsRequest(cnx);
+				}
+			}
+		} else /* if (op == uringSend) */ {
+			PROBE4(write, cnx->index, ruleIndex(cnx->server),
+				socket == &cnx->local, cqe.res);
+			flightRecord(cnx, flightWrite, socket == &cnx->local, cqe.res);
+			if (cqe.res < 0) {
+				handleClose(cnx, socket, other_socket);
+			} else {
+				handleSent(cnx, socket, other_socket, cqe.res);
+			}
+		}
+		updateInterest(cnx);
+	}
+	worker->readyCount += (unsigned)ready;
+#endif
+}
+
+static void handleRead(ConnectionInfo *cnx, Socket *socket, Socket *other_socket)
+{
+	if (cnx->coConnecting && socket == &cnx->local) {
+		handleConnect(cnx);
+		/* Closed, or connecting again to another backend */
+		if (socket->fd == INVALID_SOCKET || cnx->coConnecting) {
+			return;
+		}
+	}
+	if (socket->recvPos - other_socket->sentPos == bufferCapacity(socket)) {
+		return;
+	}
+#if HAVE_MMSG
+	/* Send the queued reply first, so that it is not merged with
+		the next one */
+	if (cnx->udpQueued && socket == &cnx->local) {
+		flushUdpReplies();
+	}
+#endif
+	int got;
+#if HAVE_ZERO_COPY
+	if (socket->recvPos == 0) {
+		/* Nothing is buffered, so we may change how we relay */
+		chooseRelayMode(socket, other_socket);
+	}
+	if (socket->pipe[1] != -1) {
+		got = splice(socket->fd, NULL, socket->pipe[1], NULL,
+			bufferCapacity(socket) - (socket->recvPos - other_socket->sentPos),
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	} else
+#endif
+	{
+		if (!socket->buffer) {
+			if (getBuffer(cnx, socket) < 0) {
+				closeUnbuffered(cnx, socket, other_socket);
+				return;
+			}
+		} else {
+			resizeBuffer(cnx, socket, other_socket);
+		}
+		/* Fill the free space up to the data not sent yet, on both
+			sides of the end of the buffer */
+		struct iovec iov[2];
+		int count = getRecvVectors(socket, other_socket, iov);
+#if _WIN32
+		/* The rest will come with the next call */
+		got = recv(socket->fd, iov[0].iov_base, (int)iov[0].iov_len, 0);
+		(void)count;
+#else
+		got = readv(socket->fd, iov, count);
+#endif
+	}
+	++worker->syscallCount;
+	countCall(callRecv, got);
+	PROBE4(read, cnx->index, ruleIndex(cnx->server),
+		socket == &cnx->local, got);
+	flightRecord(cnx, flightRead, socket == &cnx->local,
+		got < 0 ? -GetLastError() : (int)got);
+	if (got < 0) {
+		if (GetLastError() == WSAEWOULDBLOCK
+			|| GetLastError() == WSAEINPROGRESS) {
+			if (socket->recvPos == 0) {
+				freeBuffer(socket);
+			}
 			return;
 		}
 	}
@@ -545,30 +1916,162 @@ static void handleRead(ConnectionInfo *cnx, Socket *socket, Socket *other_socket
 		handleClose(cnx, socket, other_socket);
 		return;
 	}
+	if (socket == &cnx->local && !socket->recvBytes && cnx->server) {
+		recordLatency(cnx, &cnx->server->counters->firstByteTime);
+		balanceSucceeded(cnx->server, cnx->slot);
+	}
 	socket->recvBytes += got;
 	socket->recvPos += got;
+	socket->readSize += (got - socket->readSize) / 8;
+	if (socket == &cnx->remote && cnx->server) {
+		cnx->server->counters->bytesIn += got;
+	}
+	if (cnx->coStats) {
+		handleStatsRequest(cnx);
+	}
+}
+
+#if HAVE_ZERO_COPY
+static void chooseRelayMode(Socket *socket, Socket const *other_socket)
+{
+	/* Splicing saves two copies per read, but costs more than it
+		saves when reads are small. io_uring would run splices in
+		kernel worker threads, so it always copies. */
+	int wantSplice = socket->proto == protoTcp
+		&& other_socket->proto == protoTcp
+		&& options.engine != engineUring
+		&& socket->readSize >= RINETD_SPLICE_MIN_READ;
+
+	if (!wantSplice && socket->pipe[0] != -1) {
+		releasePipe(socket, 1);
+	} else if (wantSplice && socket->pipe[0] == -1) {
+		if (pipePoolCount > 0) {
+			--pipePoolCount;
+			socket->pipe[0] = pipePool[pipePoolCount][0];
+			socket->pipe[1] = pipePool[pipePoolCount][1];
+		} else if (pipe2(socket->pipe, O_NONBLOCK | O_CLOEXEC) == 0) {
+#	ifdef F_SETPIPE_SZ
+			/* Make room for data split across many pages */
+			fcntl(socket->pipe[1], F_SETPIPE_SZ, RINETD_PIPE_SIZE);
+#	endif
+		} else {
+			/* Out of file descriptors, keep copying */
+			socket->pipe[0] = socket->pipe[1] = -1;
+		}
+	}
+}
+
+static void releasePipe(Socket *socket, int empty)
+{
+	if (!pipePool) {
+		pipePool = (int (*)[2])malloc(sizeof(int[2]) * RINETD_PIPE_POOL_SIZE);
+	}
+	/* Pipes that still hold data cannot be reused */
+	if (empty && pipePool && pipePoolCount < RINETD_PIPE_POOL_SIZE) {
+		pipePool[pipePoolCount][0] = socket->pipe[0];
+		pipePool[pipePoolCount][1] = socket->pipe[1];
+		++pipePoolCount;
+	} else {
+		close(socket->pipe[0]);
+		close(socket->pipe[1]);
+	}
+	socket->pipe[0] = socket->pipe[1] = -1;
+}
+#endif
+
+/* Answer a request to the stats listener once all of it arrived,
+	by putting the page in the buffer of the local socket as if the
+	local server had sent it. */
+static void handleStatsRequest(ConnectionInfo *cnx)
+{
+	Socket *socket = &cnx->remote;
+	if (cnx->coClosing) {
+		return;
+	}
+	/* Nothing is ever sent from this buffer, so the request starts
+		at its beginning. Wait for the empty line ending the headers,
+		unless there is no room left for it. */
+	int length = socket->recvPos - cnx->local.sentPos;
+	int complete = length == socket->bufferSize;
+	for (int i = 1; i < length && !complete; ++i) {
+		complete = socket->buffer[i] == '\n' && (socket->buffer[i - 1] == '\n'
+			|| (i > 1 && socket->buffer[i - 1] == '\r'
+				&& socket->buffer[i - 2] == '\n'));
+	}
+	if (!complete) {
+		return;
+	}
+
+	/* Find how much room the page takes, then make it */
+	int size = RINETD_MIN_BUFFER_SIZE;
+	char *page = NULL;
+	while (1) {
+		page = takeBuffer(size);
+		if (!page) {
+			handleClose(cnx, socket, &cnx->local);
+			return;
+		}
+		int pageLength = statsFormat(page, size);
+		if (pageLength < size || size == RINETD_MAX_BUFFER_SIZE) {
+			length = pageLength < size ? pageLength : size - 1;
+			break;
+		}
+		releaseBuffer(page, size);
+		while (size < pageLength + 1 && size < RINETD_MAX_BUFFER_SIZE) {
+			size <<= 1;
+		}
+	}
+	cnx->local.buffer = page;
+	cnx->local.bufferSize = size;
+	cnx->local.recvPos = length;
+	socket->sentPos = 0;
+	/* Close once everything is sent, and stop reading, so that a
+		client closing its half of the connection does not cut the
+		page short */
+	cnx->coClosing = 1;
+	socket->recvPos = cnx->local.sentPos + socket->bufferSize;
 }
 
 static void handleUdpRead(ConnectionInfo *cnx, char const *buffer, int bytes)
 {
 	Socket *socket = &cnx->remote;
-	int got = bytes < RINETD_BUFFER_SIZE - socket->recvPos
-		? bytes : RINETD_BUFFER_SIZE - socket->recvPos;
-	if (got > 0) {
-		memcpy(socket->buffer + socket->recvPos, buffer, got);
-		socket->recvBytes += got;
-		socket->recvPos += got;
+	if (!socket->buffer && getBuffer(cnx, socket) < 0) {
+		return;
+	}
+	struct iovec iov[2];
+	int count = getRecvVectors(socket, &cnx->local, iov);
+	int got = 0;
+	for (int i = 0; i < count && got < bytes; ++i) {
+		int chunk = bytes - got < (int)iov[i].iov_len
+			? bytes - got : (int)iov[i].iov_len;
+		memcpy(iov[i].iov_base, buffer + got, chunk);
+		got += chunk;
+	}
+	socket->recvBytes += got;
+	socket->recvPos += got;
+	if (cnx->server) {
+		cnx->server->counters->bytesIn += got;
 	}
 }
 
 static void handleWrite(ConnectionInfo *cnx, Socket *socket, Socket *other_socket)
 {
+	if (cnx->coConnecting && socket == &cnx->local) {
+		handleConnect(cnx);
+		if (socket->fd == INVALID_SOCKET || cnx->coConnecting) {
+			return;
+		}
+	}
 	if (cnx->coClosing && (socket->sentPos == other_socket->recvPos)) {
 		PERROR("rinetd: local closed and no more output");
 		logEvent(cnx, cnx->server, cnx->coLog);
-		if (socket->proto == protoTcp)
-			closesocket(socket->fd);
-		socket->fd = INVALID_SOCKET;
+		closeSocket(cnx, socket);
+		return;
+	}
+
+	/* UDP connections share their server socket, so we may be called
+		for a connection that has nothing to send. */
+	if (socket->sentPos == other_socket->recvPos) {
 		return;
 	}
 
@@ -577,11 +2080,49 @@ static void handleWrite(ConnectionInfo *cnx, Socket *socket, Socket *other_socke
 	if (socket->proto == protoUdp && socket == &cnx->remote) {
 		addr = (struct sockaddr const*)&cnx->remoteAddress;
 		addrlen = (SOCKLEN_T)sizeof(cnx->remoteAddress);
+#if HAVE_MMSG
+		/* Send along with replies to other clients of this server */
+		if (cnx->server && cnx->server->udpBatch > 1 && udpReplies
+			&& !udpFlushing) {
+			queueUdpReply(cnx);
+			return;
+		}
+#endif
 	}
 
-	int got = sendto(socket->fd, other_socket->buffer + socket->sentPos,
-		other_socket->recvPos - socket->sentPos, 0,
-		addr, addrlen);
+	int got;
+#if HAVE_ZERO_COPY
+	if (other_socket->pipe[0] != -1) {
+		got = splice(other_socket->pipe[0], NULL, socket->fd, NULL,
+			other_socket->recvPos - socket->sentPos,
+			SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+	} else
+#endif
+	{
+		/* The data may wrap around the end of the buffer. UDP data
+			still goes out as a single datagram. */
+		struct iovec iov[2];
+		int count = getSendVectors(socket, other_socket, iov);
+#if _WIN32
+		got = sendto(socket->fd, iov[0].iov_base, (int)iov[0].iov_len, 0,
+			addr, addrlen);
+		(void)count;
+#else
+		struct msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = (void *)addr;
+		msg.msg_namelen = addrlen;
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		got = sendmsg(socket->fd, &msg, 0);
+#endif
+	}
+	++worker->syscallCount;
+	countCall(callSend, got);
+	PROBE4(write, cnx->index, ruleIndex(cnx->server),
+		socket == &cnx->local, got);
+	flightRecord(cnx, flightWrite, socket == &cnx->local,
+		got < 0 ? -GetLastError() : (int)got);
 	if (got < 0) {
 		if (GetLastError() == WSAEWOULDBLOCK) {
 			return;
@@ -592,23 +2133,287 @@ static void handleWrite(ConnectionInfo *cnx, Socket *socket, Socket *other_socke
 		handleClose(cnx, socket, other_socket);
 		return;
 	}
+	handleSent(cnx, socket, other_socket, got);
+}
+
+static void handleSent(ConnectionInfo *cnx, Socket *socket,
+	Socket *other_socket, int got)
+{
 	socket->sentPos += got;
 	socket->sentBytes += got;
-	if (socket->sentPos == other_socket->recvPos) {
+	worker->relayedBytes += got;
+	if (socket == &cnx->remote && cnx->server) {
+		cnx->server->counters->bytesOut += got;
+	}
+	/* Do not rewind while io_uring may be receiving into the buffer.
+		Give it back until more data comes. */
+	if (socket->sentPos == other_socket->recvPos
+		&& !(other_socket->pending & uringRecv)) {
 		socket->sentPos = other_socket->recvPos = 0;
+		freeBuffer(other_socket);
+	} else if (socket->sentPos >= other_socket->bufferSize) {
+		/* Keep positions small, only their difference and their
+			offset in the buffer matter */
+		socket->sentPos -= other_socket->bufferSize;
+		other_socket->recvPos -= other_socket->bufferSize;
 	}
 }
 
-static void handleClose(ConnectionInfo *cnx, Socket *socket, Socket *other_socket)
+/* Buffers are circular: the data received on a socket and not sent
+	yet to the other one lies between other_socket->sentPos and
+	socket->recvPos, modulo the buffer size, and the rest of the
+	buffer is free. These fill iov with either part, split where the
+	buffer wraps around, and return the number of entries used. */
+static int getRecvVectors(Socket const *socket, Socket const *other_socket,
+	struct iovec *iov)
 {
-	cnx->coClosing = 1;
-	if (socket->proto == protoTcp) {
-		/* One end fizzled out, so make sure we're all done with that */
+	return getVectors(socket->buffer, socket->bufferSize,
+		socket->recvPos & (socket->bufferSize - 1),
+		socket->bufferSize - (socket->recvPos - other_socket->sentPos), iov);
+}
+
+static int getSendVectors(Socket const *socket, Socket const *other_socket,
+	struct iovec *iov)
+{
+	return getVectors(other_socket->buffer, other_socket->bufferSize,
+		socket->sentPos & (other_socket->bufferSize - 1),
+		other_socket->recvPos - socket->sentPos, iov);
+}
+
+static int getVectors(char *buffer, int size, int start, int length,
+	struct iovec *iov)
+{
+	iov[0].iov_base = buffer + start;
+	if (length <= size - start) {
+		iov[0].iov_len = length;
+		return 1;
+	}
+	iov[0].iov_len = size - start;
+	iov[1].iov_base = buffer;
+	iov[1].iov_len = length - (size - start);
+	return 2;
+}
+
+static void closeSocket(ConnectionInfo *cnx, Socket *socket)
+{
+	/* The remote socket of a UDP connection is the server socket */
+	if (socket->proto == protoUdp && socket == &cnx->remote) {
+		removeUdpConnection(cnx);
+	} else {
+#if HAVE_URING
+		if (socket->pending) {
+			uringClose(socket->fd);
+		} else
+#endif
 		closesocket(socket->fd);
-	} else /* if (socket->proto == protoUdp) */ {
-		/* Nothing to do in UDP mode */
 	}
 	socket->fd = INVALID_SOCKET;
+#if HAVE_EPOLL
+	/* Closing the socket removed it from the epoll set */
+	if (socket->interest) {
+		--epollWatched;
+	}
+#endif
+	socket->interest = 0;
+	Socket *other_socket = socket == &cnx->local ? &cnx->remote : &cnx->local;
+#if HAVE_ZERO_COPY
+	/* Nothing can be sent to this socket anymore, so give back the
+		pipe of the other socket. */
+	if (other_socket->pipe[0] != -1) {
+		releasePipe(other_socket,
+			other_socket->recvPos == socket->sentPos);
+	}
+#endif
+	if (other_socket->fd == INVALID_SOCKET) {
+		timerCancel(&cnx->timer);
+		/* Buffers of sockets closed with operations still in flight
+			may be written to until they complete, see uringPass(). */
+		if (!socket->pending && !other_socket->pending) {
+			releaseConnection(cnx);
+		}
+	}
+}
+
+static int getBuffer(ConnectionInfo const *cnx, Socket *socket)
+{
+	/* Nothing is buffered, so the size may change freely */
+	int size = sizeBuffer(cnx, socket);
+	socket->buffer = takeBuffer(size);
+	if (!socket->buffer) {
+		return -1;
+	}
+	socket->bufferSize = size;
+	return 0;
+}
+
+/* Without a buffer to receive into, the socket would stay readable and
+	the event loop would spin on it, so stop relaying from it. Memory is
+	short on our side, so the backend is neither retried nor blamed. */
+static void closeUnbuffered(ConnectionInfo *cnx, Socket *socket,
+	Socket *other_socket)
+{
+	cnx->coClosing = 1;
+	handleClose(cnx, socket, other_socket);
+}
+
+static void resizeBuffer(ConnectionInfo const *cnx, Socket *socket,
+	Socket *other_socket)
+{
+	/* Move buffered data to a buffer of the new size, unless it does
+		not fit. Callers make sure no I/O is in flight on it. */
+	int length = socket->recvPos - other_socket->sentPos;
+	int size = sizeBuffer(cnx, socket);
+	if (size == socket->bufferSize || length >= size) {
+		return;
+	}
+	char *buffer = takeBuffer(size);
+	if (!buffer) {
+		return;
+	}
+	struct iovec iov[2];
+	int count = getSendVectors(other_socket, socket, iov);
+	memcpy(buffer, iov[0].iov_base, iov[0].iov_len);
+	if (count > 1) {
+		memcpy(buffer + iov[0].iov_len, iov[1].iov_base, iov[1].iov_len);
+	}
+	releaseBuffer(socket->buffer, socket->bufferSize);
+	socket->buffer = buffer;
+	socket->bufferSize = size;
+	other_socket->sentPos = 0;
+	socket->recvPos = length;
+}
+
+static char *takeBuffer(int size)
+{
+	char **freeList = &bufferFree[__builtin_ctz(size)
+		- __builtin_ctz(RINETD_MIN_BUFFER_SIZE)];
+
+	if (!*freeList) {
+		int count = size < RINETD_SLAB_SIZE ? RINETD_SLAB_SIZE / size : 1;
+		char **slabs = (char **)
+			realloc(bufferSlabs, sizeof(char *) * (bufferSlabCount + 1));
+		char *slab = slabs ? (char *)malloc((size_t)size * count) : NULL;
+		if (slabs) {
+			bufferSlabs = slabs;
+		}
+		if (!slab) {
+			syslog(LOG_ERR, "not enough memory to add buffers. "
+				"Currently %llu bytes.\n", worker->bufferBytes);
+			return NULL;
+		}
+		bufferSlabs[bufferSlabCount++] = slab;
+		for (int i = count; i-- > 0; ) {
+			char *buffer = slab + (size_t)i * size;
+			memcpy(buffer, freeList, sizeof(*freeList));
+			*freeList = buffer;
+		}
+		worker->bufferBytes += (size_t)size * count;
+	}
+
+	char *buffer = *freeList;
+	memcpy(freeList, buffer, sizeof(*freeList));
+	worker->bufferBytesUsed += size;
+	if (worker->bufferBytesUsed > worker->bufferBytesHighWater) {
+		worker->bufferBytesHighWater = worker->bufferBytesUsed;
+	}
+	return buffer;
+}
+
+static void releaseBuffer(char *buffer, int size)
+{
+	char **freeList = &bufferFree[__builtin_ctz(size)
+		- __builtin_ctz(RINETD_MIN_BUFFER_SIZE)];
+	memcpy(buffer, freeList, sizeof(*freeList));
+	*freeList = buffer;
+	worker->bufferBytesUsed -= size;
+}
+
+static int sizeBuffer(ConnectionInfo const *cnx, Socket *socket)
+{
+	/* Aim for twice the bandwidth-delay product of the data going
+		through this buffer, measured over the last second or more.
+		A buffer that limits throughput yields a product close to its
+		own size, so it keeps growing until it no longer does. */
+	time_t now = time(NULL);
+	if (socket->proto != protoTcp || now - socket->sizedTime < 1) {
+		return socket->bufferSize;
+	}
+	Socket const *other_socket =
+		socket == &cnx->local ? &cnx->remote : &cnx->local;
+	int rtt = getSocketRtt(socket->fd);
+	++worker->syscallCount;
+	if (other_socket->fd != INVALID_SOCKET
+		&& other_socket->proto == protoTcp) {
+		int otherRtt = getSocketRtt(other_socket->fd);
+		++worker->syscallCount;
+		rtt = otherRtt > rtt ? otherRtt : rtt;
+	}
+	int size = socket->bufferSize;
+	if (rtt > 0) {
+		double rate = (double)(socket->recvBytes
+			- socket->sizedBytes) / (double)(now - socket->sizedTime);
+		double product = rate * rtt / 1000000.0;
+		size = cnx->bufferMin;
+		while (size < cnx->bufferMax && size < 2 * product) {
+			size <<= 1;
+		}
+	}
+	socket->sizedTime = now;
+	socket->sizedBytes = socket->recvBytes;
+	return size;
+}
+
+/* How much may be received on a socket before it is sent on */
+static int bufferCapacity(Socket const *socket)
+{
+#if HAVE_ZERO_COPY
+	/* Pipes hold less than their size when pages are partly used,
+		see chooseRelayMode() */
+	if (socket->pipe[0] != -1) {
+		return RINETD_BUFFER_SIZE;
+	}
+#endif
+	return socket->bufferSize;
+}
+
+static void freeBuffer(Socket *socket)
+{
+	if (socket->buffer) {
+		releaseBuffer(socket->buffer, socket->bufferSize);
+		socket->buffer = NULL;
+	}
+}
+
+static void freeBuffers(void)
+{
+	while (bufferSlabCount > 0) {
+		free(bufferSlabs[--bufferSlabCount]);
+	}
+	free(bufferSlabs);
+	bufferSlabs = NULL;
+	memset(bufferFree, 0, sizeof(bufferFree));
+	worker->bufferBytes = worker->bufferBytesUsed = 0;
+}
+
+static void handleClose(ConnectionInfo *cnx, Socket *socket, Socket *other_socket)
+{
+	PROBE3(close, cnx->index, ruleIndex(cnx->server), socket == &cnx->local);
+	flightRecord(cnx, flightClose, socket == &cnx->local, 0);
+	/* Backends that reset or close connections right after accepting
+		them, before sending anything, are failing too. Idle timeouts,
+		uploads and long connections may end the same way later. */
+	if (socket == &cnx->local && socket->proto == protoTcp
+		&& !socket->recvBytes && !cnx->coClosing && cnx->connectedTime
+		&& logClock() - cnx->connectedTime < RINETD_EARLY_CLOSE_TIME) {
+		cnx->coFailed = 1;
+	}
+	if (socket == &cnx->local && retryConnection(cnx)) {
+		return;
+	}
+	int wasClosing = cnx->coClosing;
+	cnx->coClosing = 1;
+	/* One end fizzled out, so make sure we're all done with that */
+	closeSocket(cnx, socket);
 
 	if (other_socket->fd != INVALID_SOCKET) {
 		if (other_socket->proto == protoTcp) {
@@ -623,17 +2428,87 @@ static void handleClose(ConnectionInfo *cnx, Socket *socket, Socket *other_socke
 				&arg, sizeof(arg));
 #endif
 		} else /* if (other_socket->proto == protoUdp) */ {
-			if (other_socket == &cnx->local)
-				closesocket(other_socket->fd);
-			other_socket->fd = INVALID_SOCKET;
+			closeSocket(cnx, other_socket);
 		}
 
 		cnx->coLog = socket == &cnx->local ?
 			logLocalClosedFirst : logRemoteClosedFirst;
+	} else if (cnx->coRetrying || wasClosing) {
+		/* Nothing is left to write, which is where connections are
+			logged otherwise, see handleWrite(). Either the client
+			left while operations on the local socket completed
+			before a retry, see retryConnection(), or the other end
+			failed while closing. */
+		if (cnx->coRetrying) {
+			cnx->coRetrying = 0;
+			cnx->coLog = logRemoteClosedFirst;
+		}
+		logEvent(cnx, cnx->server, cnx->coLog);
+	}
+}
+
+/* Called once the local socket is readable or writable after a TCP
+	connect() that did not complete right away */
+static void handleConnect(ConnectionInfo *cnx)
+{
+	cnx->coConnecting = 0;
+	int error = 0;
+	SOCKLEN_T length = sizeof(error);
+	++worker->syscallCount;
+	if (getsockopt(cnx->local.fd, SOL_SOCKET, SO_ERROR,
+			(char *)&error, &length) == SOCKET_ERROR || error) {
+		connectFailed(cnx, error ? error : GetLastError());
+		handleClose(cnx, &cnx->local, &cnx->remote);
+		return;
+	}
+	PROBE3(connect__done, cnx->index, ruleIndex(cnx->server), 0);
+	flightRecord(cnx, flightConnectDone, 1, 0);
+	cnx->connectedTime = logClock();
+	if (cnx->remote.proto == protoTcp) {
+		timerCancel(&cnx->timer);
+	}
+	if (cnx->server) {
+		balanceConnected(cnx->server, cnx->slot,
+			recordLatency(cnx, &cnx->server->counters->connectTime), 0);
+	}
+}
+
+/* The local server could not be reached: connect() failed right away,
+	see connectBackend(), later, see handleConnect(), or timed out, see
+	handleTimeout(). This is the only place counting such failures. */
+static void connectFailed(ConnectionInfo *cnx, int error)
+{
+	PROBE3(connect__done, cnx->index, ruleIndex(cnx->server), error);
+	flightRecord(cnx, flightConnectDone, 1, error);
+	cnx->coFailed = 1;
+	if (cnx->server) {
+		++cnx->server->counters->connectFailures;
+		balanceConnected(cnx->server, cnx->slot,
+			logClock() - cnx->openedTime, 1);
+	}
+}
+
+/* Record the time since the connection was accepted, and have the
+	flight recorder log the connection once closed if it is too long */
+static long long recordLatency(ConnectionInfo *cnx, Histogram *histogram)
+{
+	long long elapsed = logClock() - cnx->openedTime;
+	histogramRecord(histogram, elapsed);
+	if (flightLatency && elapsed >= flightLatency * 1000LL) {
+		cnx->coSlow = 1;
 	}
+	return elapsed;
 }
 
 static void handleAccept(ServerInfo const *srv)
+{
+	PROBE2(accept, -1, ruleIndex(srv));
+	setPhase(phaseAccept);
+	handleAcceptSocket(srv);
+	setPhase(phaseRelay);
+}
+
+static void handleAcceptSocket(ServerInfo const *srv)
 {
 	int udpBytes = 0;
 
@@ -644,6 +2519,8 @@ static void handleAccept(ServerInfo const *srv)
 	if (srv->fromProto == protoTcp) {
 		/* In TCP mode, get remote address using accept(). */
 		nfd = accept(srv->fd, &addr, &addrlen);
+		++worker->syscallCount;
+		countCall(callAccept, nfd == INVALID_SOCKET ? -1 : 0);
 		if (nfd == INVALID_SOCKET) {
 			syslog(LOG_ERR, "accept(%d): %m\n", srv->fd);
 			logEvent(NULL, srv, logAcceptFailed);
@@ -652,6 +2529,12 @@ static void handleAccept(ServerInfo const *srv)
 
 		setSocketDefaults(nfd);
 	} else /* if (srv->fromProto == protoUdp) */ {
+#if HAVE_MMSG
+		if (srv->udpBatch > 1 && (udpMessages || allocUdpBatch() == 0)) {
+			handleUdpBatch(srv);
+			return;
+		}
+#endif
 		/* In UDP mode, get remote address using recvfrom() and check
 			for an existing connection from this client. We need
 			to read a lot of data otherwise the datagram contents
@@ -659,6 +2542,8 @@ static void handleAccept(ServerInfo const *srv)
 		nfd = srv->fd;
 		ssize_t ret = recvfrom(nfd, globalUdpBuffer,
 				sizeof(globalUdpBuffer), 0, &addr, &addrlen);
+		++worker->syscallCount;
+		countCall(callRecv, ret);
 		if (ret < 0) {
 			if (GetLastError() == WSAEWOULDBLOCK) {
 				return;
@@ -673,68 +2558,421 @@ static void handleAccept(ServerInfo const *srv)
 
 		udpBytes = (int)ret;
 
-		for (int i = 0; i < coTotal; ++i) {
-			ConnectionInfo *cnx = &coInfo[i];
-			struct sockaddr_in *addr_in = (struct sockaddr_in *)&addr;
-			if (cnx->remote.fd == nfd
-				&& cnx->remoteAddress.sin_family == addr_in->sin_family
-				&& cnx->remoteAddress.sin_port == addr_in->sin_port
-				&& cnx->remoteAddress.sin_addr.s_addr == addr_in->sin_addr.s_addr) {
-				cnx->remoteTimeout = time(NULL) + srv->serverTimeout;
-				handleUdpRead(cnx, globalUdpBuffer, udpBytes);
+		ConnectionInfo *cnx = findUdpConnection(nfd,
+			(struct sockaddr_in const *)&addr);
+		if (cnx) {
+			cnx->remoteTimeout = time(NULL) + srv->serverTimeout;
+			handleUdpRead(cnx, globalUdpBuffer, udpBytes);
+			updateInterest(cnx);
+			return;
+		}
+	}
+
+	openConnection(srv, nfd, &addr, globalUdpBuffer, udpBytes);
+}
+
+#if HAVE_MMSG
+static int allocUdpBatch(void)
+{
+	int const count = RINETD_MAX_UDP_BATCH;
+	udpMessages = (struct mmsghdr *)malloc(sizeof(struct mmsghdr) * count);
+	udpVectors = (struct iovec *)malloc(sizeof(struct iovec) * count);
+	udpAddresses = (struct sockaddr_in *)
+		malloc(sizeof(struct sockaddr_in) * count);
+	/* As large as the buffer of unbatched datagrams, and only touched
+		as far as datagrams reach */
+	udpBatchBuffer = (char *)malloc(sizeof(globalUdpBuffer) * count);
+	udpReplyMessages = (struct mmsghdr *)
+		malloc(sizeof(struct mmsghdr) * count);
+	udpReplyVectors = (struct iovec *)malloc(sizeof(struct iovec) * 2 * count);
+	udpReplies = (ConnectionInfo **)malloc(sizeof(ConnectionInfo *) * count);
+	if (!udpMessages || !udpVectors || !udpAddresses || !udpBatchBuffer
+		|| !udpReplyMessages || !udpReplyVectors || !udpReplies) {
+		syslog(LOG_ERR, "not enough memory to batch UDP datagrams.\n");
+		freeUdpBatch();
+		return -1;
+	}
+	udpReplyCount = 0;
+	return 0;
+}
+
+static void freeUdpBatch(void)
+{
+	free(udpMessages);
+	free(udpVectors);
+	free(udpAddresses);
+	free(udpBatchBuffer);
+	free(udpReplyMessages);
+	free(udpReplyVectors);
+	free(udpReplies);
+	udpMessages = NULL;
+	udpVectors = NULL;
+	udpAddresses = NULL;
+	udpBatchBuffer = NULL;
+	udpReplyMessages = NULL;
+	udpReplyVectors = NULL;
+	udpReplies = NULL;
+	udpReplyCount = 0;
+}
+
+static void handleUdpBatch(ServerInfo const *srv)
+{
+	/* Every datagram gets room for the largest UDP payload, so that
+		none is truncated */
+	for (int i = 0; i < srv->udpBatch; ++i) {
+		udpVectors[i].iov_base = udpBatchBuffer
+			+ i * sizeof(globalUdpBuffer);
+		udpVectors[i].iov_len = sizeof(globalUdpBuffer);
+		memset(&udpMessages[i].msg_hdr, 0, sizeof(struct msghdr));
+		udpMessages[i].msg_hdr.msg_name = &udpAddresses[i];
+		udpMessages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+		udpMessages[i].msg_hdr.msg_iov = &udpVectors[i];
+		udpMessages[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	int count = recvmmsg(srv->fd, udpMessages, srv->udpBatch,
+		MSG_DONTWAIT, NULL);
+	++worker->syscallCount;
+	countCall(callRecv, count);
+	if (count < 0) {
+		if (GetLastError() == WSAEWOULDBLOCK) {
+			return;
+		}
+		if (GetLastError() == WSAEINPROGRESS) {
+			return;
+		}
+		syslog(LOG_ERR, "recvmmsg(%d): %m\n", srv->fd);
+		logEvent(NULL, srv, logAcceptFailed);
+		return;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		char const *data = udpBatchBuffer + i * sizeof(globalUdpBuffer);
+		int bytes = (int)udpMessages[i].msg_len;
+		ConnectionInfo *cnx = findUdpConnection(srv->fd, &udpAddresses[i]);
+		if (!cnx) {
+			openConnection(srv, srv->fd,
+				(struct sockaddr const *)&udpAddresses[i], data, bytes);
+			continue;
+		}
+		cnx->remoteTimeout = time(NULL) + srv->serverTimeout;
+		forwardUdpData(cnx, data, bytes);
+		updateInterest(cnx);
+	}
+}
+
+static void forwardUdpData(ConnectionInfo *cnx, char const *data, int bytes)
+{
+	/* Several datagrams of a single client may come in one batch.
+		Send them to a UDP server one by one instead of merging them
+		in the buffer, unless io_uring is still sending from it. */
+	Socket *socket = &cnx->local;
+	if (socket->proto == protoUdp && socket->fd != INVALID_SOCKET
+		&& !(socket->pending & uringSend)) {
+		if (socket->sentPos < cnx->remote.recvPos) {
+			handleWrite(cnx, socket, &cnx->remote);
+		}
+		if (socket->fd != INVALID_SOCKET
+			&& socket->sentPos == cnx->remote.recvPos) {
+			int got = send(socket->fd, data, bytes, 0);
+			++worker->syscallCount;
+			countCall(callSend, got);
+			if (got >= 0) {
+				cnx->remote.recvBytes += got;
+				socket->sentBytes += got;
+				worker->relayedBytes += got;
+				if (cnx->server) {
+					cnx->server->counters->bytesIn += got;
+				}
 				return;
 			}
 		}
 	}
+	handleUdpRead(cnx, data, bytes);
+}
+
+static void queueUdpReply(ConnectionInfo *cnx)
+{
+	if (cnx->udpQueued) {
+		return;
+	}
+	if (udpReplyCount == RINETD_MAX_UDP_BATCH) {
+		flushUdpReplies();
+		/* The server socket is full, the reply waits in its buffer */
+		if (udpReplyCount == RINETD_MAX_UDP_BATCH) {
+			return;
+		}
+	}
+	cnx->udpQueued = 1;
+	udpReplies[udpReplyCount++] = cnx;
+}
+
+static void flushUdpReplies(void)
+{
+	/* Forget connections that were closed or got nothing to send */
+	int total = 0;
+	for (int i = 0; i < udpReplyCount; ++i) {
+		ConnectionInfo *cnx = udpReplies[i];
+		if (cnx->remote.fd == INVALID_SOCKET
+			|| cnx->remote.sentPos == cnx->local.recvPos) {
+			cnx->udpQueued = 0;
+		} else {
+			udpReplies[total++] = cnx;
+		}
+	}
+	udpReplyCount = 0;
+
+	/* Send consecutive replies through the same server socket at once.
+		Meanwhile, handleWrite() sends replies by itself. */
+	udpFlushing = 1;
+	for (int i = 0; i < total; ) {
+		SOCKET fd = udpReplies[i]->remote.fd;
+		int count = 0;
+		while (i + count < total && udpReplies[i + count]->remote.fd == fd) {
+			ConnectionInfo *cnx = udpReplies[i + count];
+			struct msghdr *hdr = &udpReplyMessages[count].msg_hdr;
+			memset(hdr, 0, sizeof(*hdr));
+			hdr->msg_name = &cnx->remoteAddress;
+			hdr->msg_namelen = sizeof(cnx->remoteAddress);
+			hdr->msg_iov = &udpReplyVectors[2 * count];
+			hdr->msg_iovlen = getSendVectors(&cnx->remote, &cnx->local,
+				hdr->msg_iov);
+			cnx->udpQueued = 0;
+			++count;
+		}
+
+		int sent = sendmmsg(fd, udpReplyMessages, count, 0);
+		++worker->syscallCount;
+		countCall(callSend, sent);
+		if (sent < 0) {
+			/* Queue the replies again if the socket is full, and
+				retry once it is writable, otherwise blame the first
+				one like handleWrite() */
+			if (GetLastError() == WSAEWOULDBLOCK
+				|| GetLastError() == WSAEINPROGRESS) {
+				watchUdpWritable(udpReplies[i]->server);
+				for (int k = 0; k < count; ++k) {
+					ConnectionInfo *cnx = udpReplies[i++];
+					cnx->udpQueued = 1;
+					udpReplies[udpReplyCount++] = cnx;
+				}
+			} else {
+				ConnectionInfo *cnx = udpReplies[i++];
+				handleClose(cnx, &cnx->remote, &cnx->local);
+				updateInterest(cnx);
+			}
+			continue;
+		}
+		for (int k = 0; k < sent; ++k) {
+			ConnectionInfo *cnx = udpReplies[i++];
+			handleSent(cnx, &cnx->remote, &cnx->local,
+				(int)udpReplyMessages[k].msg_len);
+			if (cnx->coClosing) {
+				handleWrite(cnx, &cnx->remote, &cnx->local);
+			}
+			updateInterest(cnx);
+		}
+	}
+	udpFlushing = 0;
+}
+
+/* Wake up once a server socket that refused replies becomes writable.
+	The select engine already watches it for every connection that has
+	data to send. */
+static void watchUdpWritable(ServerInfo const *server)
+{
+	if (!server) {
+		return;
+	}
+	int index = (int)(server - seInfo);
+	ServerInfo *srv = &seInfo[index];
+	if (srv->udpBlocked || srv->fd == INVALID_SOCKET) {
+		return;
+	}
+#	if HAVE_URING
+	if (options.engine == engineUring) {
+		struct io_uring_sqe *sqe = getSqe();
+		sqe->opcode = IORING_OP_POLL_ADD;
+		sqe->fd = srv->fd;
+#		if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		sqe->poll32_events = POLLOUT << 16;
+#		else
+		sqe->poll32_events = POLLOUT;
+#		endif
+		sqe->user_data = URING_DATA(srv->fd, uringWritable, index);
+		srv->udpBlocked = 1;
+		return;
+	}
+#	endif
+#	if HAVE_EPOLL
+	if (options.engine == engineEpoll) {
+		struct epoll_event ev;
+		ev.events = EPOLLIN | EPOLLOUT;
+		ev.data.u64 = (uint64_t)(unsigned)srv->fd << 32
+			| EPOLL_SERVER_TAG | (unsigned)index;
+		++worker->syscallCount;
+		if (epoll_ctl(epollFd, EPOLL_CTL_MOD, srv->fd, &ev) < 0) {
+			syslog(LOG_ERR, "epoll_ctl(%d): %m\n", srv->fd);
+			return;
+		}
+		srv->udpBlocked = 1;
+	}
+#	endif
+}
+#endif
 
+static void openConnection(ServerInfo const *srv, SOCKET nfd,
+                           struct sockaddr const *addr,
+                           char const *udpData, int udpBytes)
+{
 	ConnectionInfo *cnx = findAvailableConnection();
 	if (!cnx) {
 		return;
 	}
 
+	/* Buffers start at the default size, within the rule bounds,
+		until there is enough traffic to size them */
+	time_t now = time(NULL);
+	int bufferSize = RINETD_BUFFER_SIZE < srv->bufferMin ? srv->bufferMin
+		: RINETD_BUFFER_SIZE > srv->bufferMax ? srv->bufferMax
+		: RINETD_BUFFER_SIZE;
+
 	cnx->local.fd = INVALID_SOCKET;
 	cnx->local.proto = srv->toProto;
 	cnx->local.recvPos = cnx->local.sentPos = 0;
+	cnx->local.readSize = 0;
 	cnx->local.recvBytes = cnx->local.sentBytes = 0;
+	cnx->local.bufferSize = bufferSize;
+	cnx->local.sizedTime = now;
+	cnx->local.sizedBytes = 0;
 
 	cnx->remote.fd = nfd;
 	cnx->remote.proto = srv->fromProto;
 	cnx->remote.recvPos = cnx->remote.sentPos = 0;
+	cnx->remote.readSize = 0;
 	cnx->remote.recvBytes = cnx->remote.sentBytes = 0;
-	cnx->remoteAddress = *(struct sockaddr_in *)&addr;
-	if (srv->fromProto == protoUdp)
-		cnx->remoteTimeout = time(NULL) + srv->serverTimeout;
+	cnx->remote.bufferSize = bufferSize;
+	cnx->remote.sizedTime = now;
+	cnx->remote.sizedBytes = 0;
+	cnx->remoteAddress = *(struct sockaddr_in const *)addr;
+	if (srv->fromProto == protoUdp) {
+		cnx->remoteTimeout = now + srv->serverTimeout;
+	}
 
+	cnx->openedTime = logClock();
 	cnx->coClosing = 0;
 	cnx->coLog = logUnknownError;
+	cnx->coStats = srv->statsListener;
+	cnx->coForwarded = cnx->coConnecting = 0;
+	cnx->slot = -1;
+	cnx->retries = cnx->coRetrying = 0;
+	cnx->connectedTime = 0;
+	cnx->coFailed = 0;
+	cnx->bufferMin = srv->bufferMin;
+	cnx->bufferMax = srv->bufferMax;
+	cnx->flightCount = 0;
+	cnx->coSlow = 0;
+	flightRecord(cnx, flightAccept, 0, 0);
 	cnx->server = srv;
+	++srv->counters->connections;
+	if (srv->fromProto == protoTcp) {
+		++srv->counters->accepts;
+	} else {
+		++srv->counters->udpSessions;
+	}
 
 	int logCode = checkConnectionAllowed(cnx);
+	PROBE3(access, cnx->index, ruleIndex(srv), logCode);
 	if (logCode != logAllowed) {
+		if (logCode == logNotAllowed) {
+			++srv->counters->notAllowed;
+		} else {
+			++srv->counters->denied;
+		}
 		/* Local fd is not open yet, so only
 			close the remote socket. */
 		if (cnx->remote.proto == protoTcp)
 			closesocket(cnx->remote.fd);
 		cnx->remote.fd = INVALID_SOCKET;
 		logEvent(cnx, cnx->server, logCode);
+		releaseConnection(cnx);
+		return;
+	}
+
+	if (cnx->coStats) {
+		/* There is nothing to connect to, wait for the request */
+#ifndef _WIN32
+		if (cnx->remote.fd > maxfd) {
+			maxfd = cnx->remote.fd;
+		}
+#endif
+		updateInterest(cnx);
+		return;
+	}
+
+	cnx->slot = balancePick(srv, cnx->remoteAddress.sin_addr);
+	if (connectBackend(cnx) < 0 && !retryConnection(cnx)) {
+		int logCode = logLocalConnectFailed;
+		if (cnx->local.fd == INVALID_SOCKET) {
+			/* Not the fault of the backend */
+			logCode = logLocalSocketFailed;
+			balanceRelease(srv, cnx->slot);
+			cnx->slot = -1;
+		} else {
+			closesocket(cnx->local.fd);
+		}
+		if (cnx->remote.proto == protoTcp)
+			closesocket(cnx->remote.fd);
+		cnx->remote.fd = INVALID_SOCKET;
+		cnx->local.fd = INVALID_SOCKET;
+		logEvent(cnx, srv, logCode);
+		releaseConnection(cnx);
 		return;
 	}
+	cnx->coForwarded = 1;
+
+	/* Send UDP data to the other socket */
+	if (srv->fromProto == protoUdp) {
+		addUdpConnection(cnx);
+		timerSet(&cnx->timer, cnx->remoteTimeout + 1);
+#if HAVE_MMSG
+		if (srv->udpBatch > 1) {
+			forwardUdpData(cnx, udpData, udpBytes);
+		} else
+#endif
+		handleUdpRead(cnx, udpData, udpBytes);
+	}
+
+#ifndef _WIN32
+	if (cnx->remote.fd > maxfd) {
+		maxfd = cnx->remote.fd;
+	}
+#endif /* _WIN32 */
 
-	/* Now open a connection to the local server.
-		This, too, is nonblocking. Why wait
-		for anything when you don't have to? */
+	updateInterest(cnx);
+	logEvent(cnx, srv, logOpened);
+}
+
+/* Now open a connection to the backend chosen for the connection.
+	This, too, is nonblocking. Why wait for anything when you don't
+	have to? Returns -1 if the socket could not be made, or if the
+	connection failed right away. */
+static int connectBackend(ConnectionInfo *cnx)
+{
+	ServerInfo const *srv = cnx->server;
 	struct sockaddr_in saddr;
 	cnx->local.fd = srv->toProto == protoTcp
 		? socket(PF_INET, SOCK_STREAM, IPPROTO_TCP)
 		: socket(PF_INET, SOCK_DGRAM, IPPROTO_UDP);
 	if (cnx->local.fd == INVALID_SOCKET) {
 		syslog(LOG_ERR, "socket(): %m\n");
-		if (cnx->remote.proto == protoTcp)
-			closesocket(cnx->remote.fd);
-		cnx->remote.fd = INVALID_SOCKET;
-		logEvent(cnx, srv, logLocalSocketFailed);
-		return;
+		return -1;
+	}
+#ifndef _WIN32
+	if (cnx->local.fd > maxfd) {
+		maxfd = cnx->local.fd;
 	}
+#endif /* _WIN32 */
 
 	if (srv->toProto == protoTcp)
 		setSocketDefaults(cnx->local.fd);
@@ -750,25 +2988,36 @@ static void handleAccept(ServerInfo const *srv)
 		syslog(LOG_ERR, "bind(): %m\n");
 	}
 
+	Backend const *backend = &srv->backends[srv->schedule[cnx->slot]];
 	memset(&saddr, 0, sizeof(struct sockaddr_in));
 	saddr.sin_family = AF_INET;
-	memcpy(&saddr.sin_addr, &srv->localAddr, sizeof(struct in_addr));
-	saddr.sin_port = srv->localPort;
+	memcpy(&saddr.sin_addr, &backend->addr, sizeof(struct in_addr));
+	saddr.sin_port = backend->port;
+	PROBE2(connect__start, cnx->index, ruleIndex(srv));
+	flightRecord(cnx, flightConnectStart, 1, 0);
 	if (connect(cnx->local.fd, (struct sockaddr *)&saddr,
 		sizeof(struct sockaddr_in)) == SOCKET_ERROR)
 	{
 		if ((GetLastError() != WSAEINPROGRESS) &&
 			(GetLastError() != WSAEWOULDBLOCK))
 		{
+			connectFailed(cnx, GetLastError());
 			PERROR("rinetd: connect");
-			closesocket(cnx->local.fd);
-			if (cnx->remote.proto == protoTcp)
-				closesocket(cnx->remote.fd);
-			cnx->remote.fd = INVALID_SOCKET;
-			cnx->local.fd = INVALID_SOCKET;
-			logEvent(cnx, srv, logLocalConnectFailed);
-			return;
+			return -1;
 		}
+		/* Wait for the local server to accept, see handleConnect(),
+			or until the connect timeout, see handleTimeout() */
+		cnx->coConnecting = srv->toProto == protoTcp;
+		if (cnx->coConnecting && srv->fromProto == protoTcp
+			&& srv->connectTimeout) {
+			timerSet(&cnx->timer, time(NULL) + srv->connectTimeout);
+		}
+	} else if (srv->toProto == protoTcp) {
+		PROBE3(connect__done, cnx->index, ruleIndex(srv), 0);
+		flightRecord(cnx, flightConnectDone, 1, 0);
+		cnx->connectedTime = logClock();
+		balanceConnected(srv, cnx->slot,
+			recordLatency(cnx, &srv->counters->connectTime), 0);
 	}
 
 	/* Send a zero-size UDP packet to simulate a connection */
@@ -778,22 +3027,51 @@ static void handleAccept(ServerInfo const *srv)
 		/* FIXME: we ignore errors here... is it safe? */
 		(void)got;
 	}
+	return 0;
+}
 
-	/* Send UDP data to the other socket */
-	if (srv->fromProto == protoUdp) {
-		handleUdpRead(cnx, globalUdpBuffer, udpBytes);
-	}
-
-#ifndef _WIN32
-	if (cnx->local.fd > maxfd) {
-		maxfd = cnx->local.fd;
+/* Connect to another backend when the local server could not be
+	reached, or closed the connection before anything was relayed
+	either way, so that the client does not notice. Data received
+	from the client meanwhile waits in its buffer. Returns whether
+	a new connection is under way. */
+static int retryConnection(ConnectionInfo *cnx)
+{
+	ServerInfo const *srv = cnx->server;
+	if (!srv || cnx->retries >= srv->retries || cnx->coClosing
+		|| cnx->local.proto != protoTcp || cnx->remote.proto != protoTcp
+		|| cnx->local.fd == INVALID_SOCKET
+		|| cnx->remote.fd == INVALID_SOCKET
+		|| cnx->local.recvBytes || cnx->local.sentBytes) {
+		return 0;
 	}
-	if (cnx->remote.fd > maxfd) {
-		maxfd = cnx->remote.fd;
+#if HAVE_URING
+	/* A send in flight may have reached the local server already */
+	if (cnx->local.pending & uringSend) {
+		return 0;
 	}
-#endif /* _WIN32 */
+#endif
+	++cnx->retries;
+	if (cnx->coFailed) {
+		balanceFailed(srv, cnx->slot);
+		cnx->coFailed = 0;
+	}
+	cnx->connectedTime = 0;
+	cnx->slot = balanceRetry(srv, cnx->slot, cnx->remoteAddress.sin_addr);
+	closeSocket(cnx, &cnx->local);
+	/* Operations on the old socket complete first, see uringPass() */
+	if (cnx->local.pending) {
+		cnx->coRetrying = 1;
+		return 1;
+	}
+	return connectBackend(cnx) == 0 || retryConnection(cnx);
+}
 
-	logEvent(cnx, srv, logOpened);
+/* Position of a server in the configuration, for tracepoints. The
+	metrics server comes after all forwarding rules. */
+static int ruleIndex(ServerInfo const *srv)
+{
+	return srv ? (int)(srv - seInfo) : -1;
 }
 
 static int checkConnectionAllowed(ConnectionInfo const *cnx)
@@ -871,7 +3149,9 @@ static int getAddress(char const *host, struct in_addr *iaddr)
 	}
 
 	/* Otherwise, use gethostbyname() */
+	int phase = setPhase(phaseDns);
 	struct hostent *h = gethostbyname(host);
+	setPhase(phase);
 	if (h) {
 #ifdef h_addr
 		memcpy(&iaddr->s_addr, h->h_addr, 4);
@@ -917,26 +3197,326 @@ RETSIGTYPE plumber(int s)
 RETSIGTYPE hup(int s)
 {
 	(void)s;
-	syslog(LOG_INFO, "Received SIGHUP, reloading configuration...\n");
-	/* Learn the new rules */
-	clearConfiguration();
-	readConfiguration(options.conf_file);
+	/* Reload from the main loop, where no I/O is in progress */
+	reloadRequested = 1;
 #if !HAVE_SIGACTION
 	/* And reinstall the signal handler */
 	signal(SIGHUP, hup);
 #endif
 }
+
+RETSIGTYPE usr1(int s)
+{
+	(void)s;
+	statsRequested = 1;
+#if !HAVE_SIGACTION
+	signal(SIGUSR1, usr1);
+#endif
+}
 #endif /* _WIN32 */
 
+#if HAVE_WORKERS
+RETSIGTYPE wake(int s)
+{
+	/* Nothing to do, the interrupted system call is enough */
+	(void)s;
+}
+#endif
+
+static void reloadConfiguration(void)
+{
+	setPhase(phaseReload);
+	syslog(LOG_INFO, "Received SIGHUP, reloading configuration...\n");
+	closeServers();
+#if HAVE_WORKERS
+	/* Wait until no other worker uses the configuration. They may
+		be blocked waiting for events, so keep interrupting them. */
+	pthread_mutex_lock(&reloadLock);
+	__atomic_store_n(&reloadPending, 1, __ATOMIC_RELEASE);
+	interruptWorkers(&reloadStopped);
+#endif
+	/* Learn the new rules. Pending log records refer to the old
+		ones, and the log file changes. */
+	logPause();
+	clearConfiguration();
+	readConfiguration(options.conf_file);
+	logResume();
+	if (workerCount != woTotal) {
+		syslog(LOG_ERR, "changing the number of workers "
+			"requires a restart\n");
+	}
+	watchdogStart();
+#if HAVE_WORKERS
+	reloadStopped = 0;
+	__atomic_store_n(&reloadPending, 0, __ATOMIC_RELEASE);
+	pthread_cond_broadcast(&reloadCond);
+	pthread_mutex_unlock(&reloadLock);
+#endif
+	openServers();
+}
+
+/* Only open connections that would be logged once closed, as slow or
+	long, so that busy servers do not flood the log */
+static void flightDumpConnections(void)
+{
+	long long now = logClock();
+	for (int i = 0; i < coTotal; ++i) {
+		ConnectionInfo *cnx = getConnection(i);
+		if (cnx->remote.fd == INVALID_SOCKET
+			&& cnx->local.fd == INVALID_SOCKET) {
+			continue;
+		}
+		if (cnx->coSlow) {
+			flightDump(cnx, (int)(worker - woInfo), "open, slow");
+		} else if (flightDuration
+			&& now - cnx->openedTime >= flightDuration * 1000LL) {
+			flightDump(cnx, (int)(worker - woInfo), "open, long");
+		}
+	}
+}
+
+static void logStatistics(void)
+{
+	/* Compare engines by how many system calls they need to move
+		the same amount of data */
+	unsigned long long syscallCount = 0, relayedBytes = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		syscallCount += woInfo[i].syscallCount;
+		relayedBytes += woInfo[i].relayedBytes;
+	}
+	double mib = relayedBytes / 1048576.0;
+	syslog(LOG_INFO, "%s engine, %d workers: %llu I/O system calls, "
+		"%llu bytes relayed, %.1f calls per MiB\n",
+		engineNames[options.engine], woTotal, syscallCount,
+		relayedBytes, mib > 0 ? syscallCount / mib : 0.0);
+
+	/* Buffers are only held by connections with data in flight */
+	unsigned long long bufferBytes = 0, bufferBytesUsed = 0;
+	unsigned long long bufferBytesHighWater = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		bufferBytes += woInfo[i].bufferBytes;
+		bufferBytesUsed += woInfo[i].bufferBytesUsed;
+		bufferBytesHighWater += woInfo[i].bufferBytesHighWater;
+	}
+	syslog(LOG_INFO, "buffer pool: %llu KiB, %llu KiB in use, "
+		"at most %llu KiB\n", bufferBytes / 1024, bufferBytesUsed / 1024,
+		bufferBytesHighWater / 1024);
+	syslog(LOG_INFO, "access log: %llu records dropped\n",
+		logDroppedCount());
+
+	/* Whether the event loops are busy, or mostly waiting */
+	static Histogram waitTime, workTime;
+	memset(&waitTime, 0, sizeof(waitTime));
+	memset(&workTime, 0, sizeof(workTime));
+	unsigned long long watchedCount = 0, readyCount = 0;
+	unsigned long long callCount[callKinds] = { 0 };
+	unsigned long long blockedCount[callKinds] = { 0 };
+	for (int i = 0; i < woTotal; ++i) {
+		histogramMerge(&waitTime, &woInfo[i].waitTime);
+		histogramMerge(&workTime, &woInfo[i].workTime);
+		watchedCount += woInfo[i].watchedCount;
+		readyCount += woInfo[i].readyCount;
+		for (int k = 0; k < callKinds; ++k) {
+			callCount[k] += woInfo[i].callCount[k];
+			blockedCount[k] += woInfo[i].blockedCount[k];
+		}
+	}
+	unsigned long long passes = waitTime.count ? waitTime.count : 1;
+	double total = (double)(waitTime.sum + workTime.sum);
+	syslog(LOG_INFO, "event loop: %llu passes, %.1f%% of the time "
+		"waiting, %.1f watched and %.1f ready per pass\n",
+		waitTime.count, total > 0 ? 100.0 * waitTime.sum / total : 0.0,
+		(double)watchedCount / passes, (double)readyCount / passes);
+	syslog(LOG_INFO, "event loop: wait median %lld us, 99%% %lld us; "
+		"work median %lld us, 99%% %lld us\n",
+		histogramQuantile(&waitTime, 0.5), histogramQuantile(&waitTime, 0.99),
+		histogramQuantile(&workTime, 0.5), histogramQuantile(&workTime, 0.99));
+	syslog(LOG_INFO, "calls: %llu recv (%llu would block), %llu send "
+		"(%llu would block), %llu accept (%llu would block)\n",
+		callCount[callRecv], blockedCount[callRecv],
+		callCount[callSend], blockedCount[callSend],
+		callCount[callAccept], blockedCount[callAccept]);
+
+	/* Every worker logs the events of its own connections */
+	if (flightEnabled()) {
+		flightDumpConnections();
+#if HAVE_WORKERS
+		for (int i = 1; i < woTotal; ++i) {
+			__atomic_store_n(&woInfo[i].flightDumpRequested, 1,
+				__ATOMIC_RELEASE);
+			pthread_kill(woInfo[i].thread, SIGUSR2);
+		}
+#endif
+	}
+
+	if (watchdogThreshold) {
+		unsigned long long stallCount[phaseKinds] = { 0 };
+		for (int i = 0; i < woTotal; ++i) {
+			for (int p = 0; p < phaseKinds; ++p) {
+				stallCount[p] += woInfo[i].stallCount[p];
+			}
+		}
+		syslog(LOG_INFO, "watchdog: %llu stalls while %s, %llu while %s, "
+			"%llu while %s, %llu while %s, %llu while %s\n",
+			stallCount[0], watchdogPhaseName(0),
+			stallCount[1], watchdogPhaseName(1),
+			stallCount[2], watchdogPhaseName(2),
+			stallCount[3], watchdogPhaseName(3),
+			stallCount[4], watchdogPhaseName(4));
+	}
+}
+
+static void publishCounters(Timer *timer)
+{
+	WorkerInfo *info = (WorkerInfo *)timer->data;
+	segmentPublish((int)(info - woInfo));
+	timerSet(timer, time(NULL) + 1);
+}
+
+static void startWorkers(void)
+{
+	woTotal = workerCount;
+#if !HAVE_WORKERS
+	if (woTotal > 1) {
+		syslog(LOG_ERR, "multiple workers are not supported "
+			"on this system\n");
+		woTotal = 1;
+	}
+#endif
+	woInfo = (WorkerInfo *)calloc(woTotal, sizeof(WorkerInfo));
+	if (!woInfo) {
+		exit(1);
+	}
+	for (int i = 0; i < woTotal; ++i) {
+		timerInit(&woInfo[i].segmentTimer, publishCounters, &woInfo[i]);
+	}
+	worker = &woInfo[0];
+#if HAVE_WORKERS
+	woInfo[0].thread = pthread_self();
+	/* Signals are only handled by the main thread */
+	sigset_t mask, oldmask;
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGHUP);
+	sigaddset(&mask, SIGUSR1);
+	sigaddset(&mask, SIGINT);
+	sigaddset(&mask, SIGTERM);
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+	for (int i = 1; i < woTotal; ++i) {
+		int ret = pthread_create(&woInfo[i].thread, NULL,
+			workerThread, &woInfo[i]);
+		if (ret != 0) {
+			errno = ret;
+			syslog(LOG_ERR, "could only start %d workers (%m)\n", i);
+			woTotal = i;
+			break;
+		}
+	}
+	pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+#endif
+}
+
+#if HAVE_WORKERS
+static void *workerThread(void *arg)
+{
+	worker = (WorkerInfo *)arg;
+#	if HAVE_URING
+	if (options.engine == engineUring
+		&& uringInit(RINETD_URING_ENTRIES) < 0) {
+		syslog(LOG_ERR, "io_uring_setup(): %m\n");
+		exit(1);
+	}
+#	endif
+#	if HAVE_EPOLL
+	if (options.engine == engineEpoll) {
+		epollFd = epoll_create1(EPOLL_CLOEXEC);
+		if (epollFd < 0) {
+			syslog(LOG_ERR, "epoll_create1(): %m\n");
+			exit(1);
+		}
+	}
+#	endif
+
+	openServers();
+	while (!__atomic_load_n(&quitPending, __ATOMIC_ACQUIRE)) {
+		eventPass();
+		if (__atomic_load_n(&reloadPending, __ATOMIC_ACQUIRE)) {
+			waitForReload();
+		}
+	}
+	pthread_mutex_lock(&reloadLock);
+	++quitStopped;
+	pthread_cond_broadcast(&reloadCond);
+	pthread_mutex_unlock(&reloadLock);
+	return NULL;
+}
+
+/* Keep interrupting the other workers, which may be blocked waiting
+	for events, until they all stopped. Called with reloadLock held. */
+static void interruptWorkers(int const *stopped)
+{
+	while (*stopped < woTotal - 1) {
+		for (int i = 1; i < woTotal; ++i) {
+			pthread_kill(woInfo[i].thread, SIGUSR2);
+		}
+		struct timespec deadline;
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += 10000000;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_nsec -= 1000000000;
+			++deadline.tv_sec;
+		}
+		pthread_cond_timedwait(&reloadCond, &reloadLock, &deadline);
+	}
+}
+
+static void waitForReload(void)
+{
+	/* Waiting is not stalling */
+	__atomic_store_n(&worker->busySince, 0, __ATOMIC_RELAXED);
+	closeServers();
+	pthread_mutex_lock(&reloadLock);
+	++reloadStopped;
+	pthread_cond_broadcast(&reloadCond);
+	while (reloadPending) {
+		pthread_cond_wait(&reloadCond, &reloadLock);
+	}
+	pthread_mutex_unlock(&reloadLock);
+	openServers();
+}
+#endif
+
 RETSIGTYPE quit(int s)
 {
 	(void)s;
+	/* Quit from the main loop, since the log lock or memory
+		allocations may be held by the code interrupted here */
+	quitRequested = 1;
+#if !HAVE_SIGACTION
+	signal(s, quit);
+#endif
+}
+
+static void shutdownGracefully(void)
+{
+#if HAVE_WORKERS
+	/* Nobody may publish counters or log anything past this point */
+	pthread_mutex_lock(&reloadLock);
+	__atomic_store_n(&quitPending, 1, __ATOMIC_RELEASE);
+	interruptWorkers(&quitStopped);
+	pthread_mutex_unlock(&reloadLock);
+	for (int i = 1; i < woTotal; ++i) {
+		pthread_join(woInfo[i].thread, NULL);
+	}
+#endif
 	/* Obey the request, but first flush the log */
+	logPause();
 	if (logFile) {
 		fclose(logFile);
 	}
+	segmentClose();
 	/* ...and get rid of memory allocations */
-	setConnectionCount(0);
+	closeServers();
+	freeConnections();
 	clearConfiguration();
 	exit(0);
 }
@@ -968,83 +3548,28 @@ error:
 
 static void logEvent(ConnectionInfo const *cnx, ServerInfo const *srv, int result)
 {
-	/* Bit of borrowing from Apache logging module here,
-		thanks folks */
-	int timz;
-	char tstr[1024];
-	struct tm *t = get_gmtoff(&timz);
-	char sign = (timz < 0 ? '-' : '+');
-	if (timz < 0) {
-		timz = -timz;
+	/* The closing record has everything the opening one has, and
+		requests for the metrics page are not logged */
+	if ((result == logOpened && logCloseOnly) || (cnx && cnx->coStats)) {
+		return;
 	}
-	strftime(tstr, sizeof(tstr), "%d/%b/%Y:%H:%M:%S ", t);
-
-	char const *addressText = "?";
-	int bytesOutput = 0;
-	int bytesInput = 0;
+	/* Formatting and writing happen later, see log.c */
+	LogRecord record;
+	record.startTime = record.endTime = logClock();
+	record.connection = cnx != NULL;
+	record.bytesInput = record.bytesOutput = 0;
 	if (cnx != NULL) {
-		addressText = inet_ntoa(cnx->remoteAddress.sin_addr);
-		bytesOutput = cnx->remote.sentBytes;
-		bytesInput = cnx->remote.recvBytes;
-	}
-
-	char const *fromHost = "?";
-	int fromPort = 0;
-	char const *toHost =  "?";
-	int toPort =  0;
-	if (srv != NULL) {
-		fromHost = srv->fromHost;
-		fromPort = srv->fromPort;
-		toHost = srv->toHost;
-		toPort = srv->toPort;
-	}
-
-	if (result==logNotAllowed || result==logDenied)
-		syslog(LOG_INFO, "%s %s\n"
-			, addressText
-			, logMessages[result]);
-	if (logFile) {
-		if (logFormatCommon) {
-			/* Fake a common log format log file in a way that
-				most web analyzers can do something interesting with.
-				We lie and say the protocol is HTTP because we don't
-				want the web analyzer to reject the line. We also
-				lie and claim success (code 200) because we don't
-				want the web analyzer to ignore the line as an
-				error and not analyze the "URL." We put a result
-				message into our "URL" instead. The last field
-				is an extra, giving the number of input bytes,
-				after several placeholders meant to fill the
-				positions frequently occupied by user agent,
-				referrer, and server name information. */
-			fprintf(logFile, "%s - - "
-				"[%s %c%.2d%.2d] "
-				"\"GET /rinetd-services/%s/%d/%s/%d/%s HTTP/1.0\" "
-				"200 %d - - - %d\n",
-				addressText,
-				tstr,
-				sign,
-				timz / 60,
-				timz % 60,
-				fromHost, fromPort,
-				toHost, toPort,
-				logMessages[result],
-				bytesOutput,
-				bytesInput);
-		} else {
-			/* Write an rinetd-specific log entry with a
-				less goofy format. */
-			fprintf(logFile, "%s\t%s\t%s\t%d\t%s\t%d\t%d"
-					"\t%d\t%s\n",
-				tstr,
-				addressText,
-				fromHost, fromPort,
-				toHost, toPort,
-				bytesInput,
-				bytesOutput,
-				logMessages[result]);
-		}
-	}
+		record.startTime = cnx->openedTime;
+		record.address = cnx->remoteAddress.sin_addr;
+		record.bytesOutput = cnx->remote.sentBytes;
+		record.bytesInput = cnx->remote.recvBytes;
+	}
+	/* Servers of workers are copies of allServers */
+	record.server = srv != NULL ? (int)(srv - seInfo) : -1;
+	record.backend = srv != NULL && cnx != NULL && cnx->slot >= 0
+		? srv->schedule[cnx->slot] : -1;
+	record.result = result;
+	logPush(&record);
 }
 
 static int readArgs (int argc, char **argv, RinetdOptions *options)
@@ -1053,12 +3578,13 @@ static int readArgs (int argc, char **argv, RinetdOptions *options)
 		int option_index = 0;
 		static struct option long_options[] = {
 			{"conf-file",  1, 0, 'c'},
+			{"engine",     1, 0, 'e'},
 			{"foreground", 0, 0, 'f'},
 			{"help",       0, 0, 'h'},
 			{"version",    0, 0, 'v'},
 			{0, 0, 0, 0}
 		};
-		int c = getopt_long (argc, argv, "c:fshv",
+		int c = getopt_long (argc, argv, "c:e:fshv",
 			long_options, &option_index);
 		if (c == -1) {
 			break;
@@ -1072,6 +3598,23 @@ static int readArgs (int argc, char **argv, RinetdOptions *options)
 					exit(1);
 				}
 				break;
+			case 'e':
+				if (!strcmp(optarg, "select")) {
+					options->engine = engineSelect;
+#if HAVE_EPOLL
+				} else if (!strcmp(optarg, "epoll")) {
+					options->engine = engineEpoll;
+#endif
+#if HAVE_URING
+				} else if (!strcmp(optarg, "io_uring")) {
+					options->engine = engineUring;
+#endif
+				} else {
+					fprintf(stderr, "rinetd: unsupported event "
+						"engine `%s'.\n", optarg);
+					exit(1);
+				}
+				break;
 			case 'f':
 				options->foreground = 1;
 				break;
@@ -1079,6 +3622,10 @@ static int readArgs (int argc, char **argv, RinetdOptions *options)
 				printf("Usage: rinetd [OPTION]\n"
 					"  -c, --conf-file FILE   read configuration "
 					"from FILE\n"
+					"  -e, --engine ENGINE    wait for events "
+					"using ENGINE\n"
+					"                         (select, epoll, "
+					"io_uring)\n"
 					"  -f, --foreground       do not run in the "
 					"background\n"
 					"  -h, --help             display this help\n"
@@ -1098,21 +3645,3 @@ static int readArgs (int argc, char **argv, RinetdOptions *options)
 	}
 	return 0;
 }
-
-/* get_gmtoff was borrowed from Apache. Thanks folks. */
-
-static struct tm *get_gmtoff(int *tz)
-{
-	time_t tt = time(NULL);
-
-	/* Assume we are never more than 24 hours away. */
-	struct tm gmt = *gmtime(&tt); /* remember gmtime/localtime return ptr to static */
-	struct tm *t = localtime(&tt); /* buffer... so be careful */
-	int days = t->tm_yday - gmt.tm_yday;
-	int hours = ((days < -1 ? 24 : 1 < days ? -24 : days * 24)
-		+ t->tm_hour - gmt.tm_hour);
-	int minutes = hours * 60 + t->tm_min - gmt.tm_min;
-	*tz = minutes;
-	return t;
-}
-
@@ -22,8 +22,26 @@
 /* Constants */
 
 static int const RINETD_BUFFER_SIZE = 16384;
+static int const RINETD_MIN_BUFFER_SIZE = 4096;
+static int const RINETD_MAX_BUFFER_SIZE = 16777216;
+static int const RINETD_DEFAULT_MAX_BUFFER_SIZE = 1048576;
+static int const RINETD_SLAB_SIZE = 524288;
 static int const RINETD_LISTEN_BACKLOG = 128;
 static int const RINETD_DEFAULT_UDP_TIMEOUT = 72;
+static int const RINETD_EPOLL_EVENTS = 256;
+static int const RINETD_URING_ENTRIES = 4096;
+static int const RINETD_MAX_WORKERS = 1024;
+static int const RINETD_SPLICE_MIN_READ = 4096;
+static int const RINETD_PIPE_SIZE = 262144;
+static int const RINETD_PIPE_POOL_SIZE = 256;
+static int const RINETD_MAX_UDP_BATCH = 64;
+static int const RINETD_LOG_RING_SIZE = 4096;
+static int const RINETD_MAX_WEIGHT = 100;
+static int const RINETD_HASH_TABLE_SIZE = 65537;
+static int const RINETD_FAILED_CONNECT_TIME = 1000000;
+static int const RINETD_BALANCE_FORGET_TIME = 10;
+static int const RINETD_MAX_EJECT_TIME = 300;
+static int const RINETD_EARLY_CLOSE_TIME = 1000000;
 
 #define RINETD_CONFIG_FILE "/etc/rinetd.conf"
 #define RINETD_PID_FILE "/var/run/rinetd.pid"
@@ -34,17 +52,29 @@ extern Rule *allRules;
 extern int allRulesCount;
 extern int globalRulesCount;
 
-extern ServerInfo *seInfo;
-extern int seTotal;
+extern ServerInfo *allServers;
+extern int allServersCount;
+extern int workerCount;
+extern WorkerInfo *woInfo;
+extern int woTotal;
 
 extern char *logFileName;
 extern char *pidLogFileName;
-extern int logFormatCommon;
+extern char *statsFileName;
+extern int watchdogThreshold;
+extern int flightLatency, flightDuration;
+extern int logFormat;
+extern int logCloseOnly;
 extern FILE *logFile;
+extern RinetdOptions options;
 
 /* Functions */
 
 void addServer(char *bindAddress, int bindPort, int bindProto,
                char *connectAddress, int connectPort, int connectProto,
-               int serverTimeout, char *sourceAddress);
+               int serverTimeout, int udpBatch, int bufferMin, int bufferMax,
+               char *sourceAddress, int balance, int weight);
+void addBackend(char *connectAddress, int connectPort, int connectProto,
+                int weight);
+void addStatsServer(char *bindAddress, int bindPort);
 
@@ -0,0 +1,204 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#if HAVE_SYS_MMAN_H
+#	include <sys/mman.h>
+#endif
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "segment.h"
+
+/* Only changed by the main thread, while the other workers wait for
+	the configuration to be reloaded */
+static SegmentHeader *segment = NULL;
+static size_t segmentSize = 0;
+static char *segmentPath = NULL;
+static time_t segmentStartTime = 0;
+
+static void segmentRetire(char const *newPath);
+
+static size_t segmentAlign(size_t size)
+{
+	/* Keep workers apart from each other's cache lines */
+	return (size + 63) & ~(size_t)63;
+}
+
+/* Make a new file for the current configuration, and retire the
+	previous one. Without a path, only retire it. */
+void segmentOpen(char const *path, int workers)
+{
+#if HAVE_SYS_MMAN_H
+	if (!segmentStartTime) {
+		segmentStartTime = time(NULL);
+	}
+	if (!path) {
+		segmentRetire(NULL);
+		return;
+	}
+
+	size_t ruleOffset = segmentAlign(sizeof(SegmentHeader));
+	size_t workerOffset = segmentAlign(ruleOffset
+		+ sizeof(SegmentRule) * allServersCount);
+	size_t workerSize = segmentAlign(sizeof(SegmentWorker)
+		+ sizeof(SegmentCounters) * allServersCount);
+	size_t size = workerOffset + workerSize * workers;
+
+	/* Readers only ever find a complete file */
+	size_t length = strlen(path);
+	char *newPath = (char *)malloc(length + 5);
+	char *copy = (char *)malloc(length + 1);
+	if (!newPath || !copy) {
+		free(newPath);
+		free(copy);
+		return;
+	}
+	sprintf(newPath, "%s.new", path);
+	strcpy(copy, path);
+	int fd = open(newPath, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	SegmentHeader *header = NULL;
+	if (fd >= 0 && ftruncate(fd, (off_t)size) == 0) {
+		void *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+			fd, 0);
+		header = map == MAP_FAILED ? NULL : (SegmentHeader *)map;
+	}
+	if (!header) {
+		syslog(LOG_ERR, "could not create %s (%m)\n", newPath);
+		if (fd >= 0) {
+			close(fd);
+			unlink(newPath);
+		}
+		free(newPath);
+		free(copy);
+		return;
+	}
+	close(fd);
+
+	/* The file is all zeroes, workers fill their part later */
+	memcpy(header->magic, SEGMENT_MAGIC, sizeof(header->magic));
+	header->version = segmentVersion;
+	header->ruleCount = (uint32_t)allServersCount;
+	header->workerCount = (uint32_t)workers;
+	header->ruleSize = sizeof(SegmentRule);
+	header->workerSize = (uint32_t)workerSize;
+	header->ruleOffset = ruleOffset;
+	header->workerOffset = workerOffset;
+	header->startTime = segmentStartTime;
+	header->loadTime = time(NULL);
+	header->engine = (uint32_t)options.engine;
+	SegmentRule *rules = (SegmentRule *)((char *)header + ruleOffset);
+	for (int i = 0; i < allServersCount; ++i) {
+		ServerInfo const *srv = &allServers[i];
+		snprintf(rules[i].fromHost, sizeof(rules[i].fromHost), "%s",
+			srv->fromHost);
+		snprintf(rules[i].toHost, sizeof(rules[i].toHost), "%s",
+			srv->toHost);
+		rules[i].fromPort = (uint16_t)srv->fromPort;
+		rules[i].toPort = (uint16_t)srv->toPort;
+		rules[i].fromProto = (uint8_t)srv->fromProto;
+		rules[i].toProto = (uint8_t)srv->toProto;
+	}
+
+	if (rename(newPath, path) != 0) {
+		syslog(LOG_ERR, "could not rename %s (%m)\n", newPath);
+		munmap(header, size);
+		unlink(newPath);
+		free(newPath);
+		free(copy);
+		return;
+	}
+	free(newPath);
+	segmentRetire(path);
+	__atomic_store_n(&segment, header, __ATOMIC_RELEASE);
+	segmentSize = size;
+	segmentPath = copy;
+#else
+	if (path) {
+		syslog(LOG_ERR, "statistics files are not supported "
+			"on this system\n");
+	}
+	(void)workers;
+#endif
+}
+
+/* Copy the counters of a worker, see segment.h */
+void segmentPublish(int worker)
+{
+	SegmentHeader *header = __atomic_load_n(&segment, __ATOMIC_ACQUIRE);
+	if (!header || worker >= (int)header->workerCount) {
+		return;
+	}
+	WorkerInfo const *info = &woInfo[worker];
+	SegmentWorker *slot = (SegmentWorker *)((char *)header
+		+ header->workerOffset + (size_t)header->workerSize * worker);
+	SegmentCounters *counters = (SegmentCounters *)(slot + 1);
+
+	uint32_t sequence = slot->sequence;
+	__atomic_store_n(&slot->sequence, sequence + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	slot->updateTime = time(NULL);
+	slot->loopCount = info->loopCount;
+	slot->syscallCount = info->syscallCount;
+	slot->relayedBytes = info->relayedBytes;
+	slot->bufferBytes = info->bufferBytes;
+	slot->bufferBytesUsed = info->bufferBytesUsed;
+	slot->connectionSlots = (uint64_t)info->connectionSlots;
+	/* The stats listener of the main thread comes after the rules */
+	int count = info->serverCount < (int)header->ruleCount
+		? info->serverCount : (int)header->ruleCount;
+	for (int i = 0; i < count; ++i) {
+		ServerCounters const *from = &info->serverCounters[i];
+		counters[i].connections = from->connections;
+		counters[i].accepts = from->accepts;
+		counters[i].udpSessions = from->udpSessions;
+		counters[i].notAllowed = from->notAllowed;
+		counters[i].denied = from->denied;
+		counters[i].connectFailures = from->connectFailures;
+		counters[i].bytesIn = from->bytesIn;
+		counters[i].bytesOut = from->bytesOut;
+	}
+	__atomic_store_n(&slot->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+/* Retire the file for good, when quitting */
+void segmentClose(void)
+{
+	segmentRetire(NULL);
+}
+
+static void segmentRetire(char const *newPath)
+{
+#if HAVE_SYS_MMAN_H
+	if (!segment) {
+		return;
+	}
+	/* Readers that still map the old file learn that they should
+		open it again */
+	__atomic_store_n(&segment->retired, 1, __ATOMIC_RELEASE);
+	munmap(segment, segmentSize);
+	segment = NULL;
+	segmentSize = 0;
+	if (!newPath || strcmp(newPath, segmentPath) != 0) {
+		unlink(segmentPath);
+	}
+	free(segmentPath);
+	segmentPath = NULL;
+#else
+	(void)newPath;
+#endif
+}
@@ -0,0 +1,78 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+#include <stdint.h>
+
+/* Statistics file, mapped in memory by rinetd and by rinetd-top.
+	Each worker copies its counters to its own part of the file once
+	per second, between two increments of a sequence number that is
+	thus odd while copying; readers try again rather than ever making
+	a worker wait. When the configuration is reloaded, a new file
+	replaces the old one, which is marked as retired. */
+
+#define RINETD_STATS_FILE "/run/rinetd.stats"
+#define SEGMENT_MAGIC "RINETDS"
+
+enum {
+	segmentVersion = 1,
+};
+
+/* Sizes and offsets are given so that fields can be added at the
+	end of each part without breaking older readers */
+typedef struct _segment_header SegmentHeader;
+struct _segment_header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t retired;
+	uint32_t ruleCount, workerCount;
+	uint32_t ruleSize, workerSize;
+	uint64_t ruleOffset, workerOffset;
+	/* In seconds since the epoch */
+	int64_t startTime, loadTime;
+	uint32_t engine;
+	uint32_t reserved;
+};
+
+typedef struct _segment_rule SegmentRule;
+struct _segment_rule
+{
+	char fromHost[256], toHost[256];
+	uint16_t fromPort, toPort;
+	uint8_t fromProto, toProto;
+	uint8_t reserved[2];
+};
+
+/* Same as ServerCounters */
+typedef struct _segment_counters SegmentCounters;
+struct _segment_counters
+{
+	uint64_t connections;
+	uint64_t accepts, udpSessions;
+	uint64_t notAllowed, denied, connectFailures;
+	uint64_t bytesIn, bytesOut;
+};
+
+/* Followed by the counters of each rule */
+typedef struct _segment_worker SegmentWorker;
+struct _segment_worker
+{
+	uint32_t sequence;
+	uint32_t reserved;
+	/* In seconds since the epoch, on the tick of the publishing timer,
+		so that readers get rates from the time between two copies */
+	int64_t updateTime;
+	uint64_t loopCount, syscallCount, relayedBytes;
+	uint64_t bufferBytes, bufferBytesUsed, connectionSlots;
+};
+
+void segmentOpen(char const *path, int workers);
+void segmentPublish(int worker);
+void segmentClose(void);
@@ -0,0 +1,401 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "log.h"
+#include "stats.h"
+#include "histogram.h"
+#include "watchdog.h"
+
+typedef struct _stats_page StatsPage;
+struct _stats_page
+{
+	char *buffer;
+	int size, length;
+};
+
+/* Per server metrics, each one a sum of a ServerCounters field */
+static struct {
+	char const *name, *type, *help;
+	size_t offset;
+} const serverMetrics[] = {
+	{ "rinetd_connections", "gauge",
+		"Connections currently open",
+		offsetof(ServerCounters, connections) },
+	{ "rinetd_accepts", "counter",
+		"TCP connections accepted",
+		offsetof(ServerCounters, accepts) },
+	{ "rinetd_udp_sessions", "counter",
+		"UDP sessions started by a datagram from a new client",
+		offsetof(ServerCounters, udpSessions) },
+	{ "rinetd_not_allowed", "counter",
+		"Clients that matched no allow rule",
+		offsetof(ServerCounters, notAllowed) },
+	{ "rinetd_denied", "counter",
+		"Clients that matched a deny rule",
+		offsetof(ServerCounters, denied) },
+	{ "rinetd_connect_failures", "counter",
+		"Connections to the forwarded-to address that failed",
+		offsetof(ServerCounters, connectFailures) },
+	{ "rinetd_received_bytes", "counter",
+		"Bytes received from clients",
+		offsetof(ServerCounters, bytesIn) },
+	{ "rinetd_sent_bytes", "counter",
+		"Bytes sent to clients",
+		offsetof(ServerCounters, bytesOut) },
+};
+
+/* Per server latencies, each one a merge of a ServerCounters field */
+static struct {
+	char const *name, *help;
+	size_t offset;
+} const serverHistograms[] = {
+	{ "rinetd_connect_seconds",
+		"Time from accepting a connection until connected to the "
+		"forwarded-to address",
+		offsetof(ServerCounters, connectTime) },
+	{ "rinetd_first_byte_seconds",
+		"Time from accepting a connection until the first byte from the "
+		"forwarded-to address",
+		offsetof(ServerCounters, firstByteTime) },
+	{ "rinetd_connection_seconds",
+		"Time from accepting a connection until it is closed",
+		offsetof(ServerCounters, duration) },
+};
+
+/* Per backend metrics, each one a sum of a BackendCounters field */
+static struct {
+	char const *name, *type, *help;
+	size_t offset;
+} const backendMetrics[] = {
+	{ "rinetd_backend_connections", "gauge",
+		"Connections currently open to the backend",
+		offsetof(BackendCounters, connections) },
+	{ "rinetd_backend_connects", "counter",
+		"Connections started to the backend",
+		offsetof(BackendCounters, connects) },
+	{ "rinetd_backend_connect_failures", "counter",
+		"Connections to the backend that failed",
+		offsetof(BackendCounters, connectFailures) },
+	{ "rinetd_backend_ejections", "counter",
+		"Times the backend was ejected after failures in a row",
+		offsetof(BackendCounters, ejections) },
+};
+
+static double const quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+
+static void statsPrint(StatsPage *page, char const *format, ...);
+static void statsFamily(StatsPage *page, char const *name,
+	char const *type, char const *help);
+static void statsSummary(StatsPage *page, char const *name,
+	char const *labels, Histogram const *histogram);
+static unsigned long long statsServerSum(int server, size_t offset);
+static void statsServerMerge(int server, size_t offset, Histogram *total);
+static unsigned long long statsBackendSum(int server, int backend,
+	size_t offset);
+static long long statsBackendConnectTime(int server, int backend);
+
+/* Write the page, headers included. Returns its length, which is
+	not less than size if it was cut short. */
+int statsFormat(char *buffer, int size)
+{
+	StatsPage page = { buffer, size, 0 };
+	statsPrint(&page, "HTTP/1.0 200 OK\r\n"
+		"Content-Type: application/openmetrics-text; version=1.0.0; "
+		"charset=utf-8\r\n"
+		"Connection: close\r\n\r\n");
+
+	/* Host names only ever contain letters, digits and "-_.", so
+		nothing needs escaping */
+	static char const *const protoNames[] = { "?", "tcp", "udp" };
+	for (size_t m = 0; m < sizeof(serverMetrics) / sizeof(*serverMetrics);
+			++m) {
+		int counter = serverMetrics[m].type[0] == 'c';
+		statsFamily(&page, serverMetrics[m].name, serverMetrics[m].type,
+			serverMetrics[m].help);
+		for (int i = 0; i < allServersCount; ++i) {
+			ServerInfo const *srv = &allServers[i];
+			statsPrint(&page, "%s%s{bind=\"%s:%d/%s\","
+					"connect=\"%s:%d/%s\"} %llu\n",
+				serverMetrics[m].name, counter ? "_total" : "",
+				srv->fromHost, srv->fromPort, protoNames[srv->fromProto],
+				srv->toHost, srv->toPort, protoNames[srv->toProto],
+				statsServerSum(i, serverMetrics[m].offset));
+		}
+	}
+
+	/* Histograms are too large for the stack */
+	static Histogram histogram;
+	for (size_t h = 0;
+			h < sizeof(serverHistograms) / sizeof(*serverHistograms); ++h) {
+		char const *name = serverHistograms[h].name;
+		statsFamily(&page, name, "summary", serverHistograms[h].help);
+		for (int i = 0; i < allServersCount; ++i) {
+			ServerInfo const *srv = &allServers[i];
+			char labels[600];
+			snprintf(labels, sizeof(labels),
+				"bind=\"%s:%d/%s\",connect=\"%s:%d/%s\"",
+				srv->fromHost, srv->fromPort, protoNames[srv->fromProto],
+				srv->toHost, srv->toPort, protoNames[srv->toProto]);
+			memset(&histogram, 0, sizeof(histogram));
+			statsServerMerge(i, serverHistograms[h].offset, &histogram);
+			statsSummary(&page, name, labels, &histogram);
+		}
+	}
+
+	for (size_t m = 0;
+			m < sizeof(backendMetrics) / sizeof(*backendMetrics); ++m) {
+		int counter = backendMetrics[m].type[0] == 'c';
+		statsFamily(&page, backendMetrics[m].name, backendMetrics[m].type,
+			backendMetrics[m].help);
+		for (int i = 0; i < allServersCount; ++i) {
+			ServerInfo const *srv = &allServers[i];
+			for (int b = 0; b < srv->backendCount; ++b) {
+				statsPrint(&page, "%s%s{bind=\"%s:%d/%s\","
+						"backend=\"%s:%d/%s\"} %llu\n",
+					backendMetrics[m].name, counter ? "_total" : "",
+					srv->fromHost, srv->fromPort,
+					protoNames[srv->fromProto], srv->backends[b].host,
+					srv->backends[b].portNum, protoNames[srv->toProto],
+					statsBackendSum(i, b, backendMetrics[m].offset));
+			}
+		}
+	}
+	statsFamily(&page, "rinetd_backend_up", "gauge",
+		"Whether the backend passes its health checks, or has none");
+	for (int i = 0; i < allServersCount; ++i) {
+		ServerInfo const *srv = &allServers[i];
+		for (int b = 0; b < srv->backendCount; ++b) {
+			statsPrint(&page, "rinetd_backend_up{bind=\"%s:%d/%s\","
+					"backend=\"%s:%d/%s\"} %d\n",
+				srv->fromHost, srv->fromPort, protoNames[srv->fromProto],
+				srv->backends[b].host, srv->backends[b].portNum,
+				protoNames[srv->toProto],
+				!__atomic_load_n(&srv->backends[b].down, __ATOMIC_RELAXED));
+		}
+	}
+	statsFamily(&page, "rinetd_backend_connect_average_seconds", "gauge",
+		"Moving average of the time to connect to the backend");
+	for (int i = 0; i < allServersCount; ++i) {
+		ServerInfo const *srv = &allServers[i];
+		for (int b = 0; b < srv->backendCount; ++b) {
+			statsPrint(&page, "rinetd_backend_connect_average_seconds{"
+					"bind=\"%s:%d/%s\",backend=\"%s:%d/%s\"} %.6f\n",
+				srv->fromHost, srv->fromPort, protoNames[srv->fromProto],
+				srv->backends[b].host, srv->backends[b].portNum,
+				protoNames[srv->toProto],
+				statsBackendConnectTime(i, b) / 1e6);
+		}
+	}
+
+	unsigned long long loopCount = 0, syscallCount = 0, relayedBytes = 0;
+	unsigned long long bufferBytes = 0, bufferBytesUsed = 0;
+	unsigned long long connectionSlots = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		WorkerInfo const *info = &woInfo[i];
+		loopCount += info->loopCount;
+		syscallCount += info->syscallCount;
+		relayedBytes += info->relayedBytes;
+		bufferBytes += info->bufferBytes;
+		bufferBytesUsed += info->bufferBytesUsed;
+		connectionSlots += (unsigned)info->connectionSlots;
+	}
+	statsFamily(&page, "rinetd_connection_slots", "gauge",
+		"Connection slots allocated by all workers");
+	statsPrint(&page, "rinetd_connection_slots %llu\n", connectionSlots);
+	statsFamily(&page, "rinetd_buffer_pool_bytes", "gauge",
+		"Memory allocated for connection buffers");
+	statsPrint(&page, "rinetd_buffer_pool_bytes %llu\n", bufferBytes);
+	statsFamily(&page, "rinetd_buffer_used_bytes", "gauge",
+		"Memory of the connection buffers holding data in flight");
+	statsPrint(&page, "rinetd_buffer_used_bytes %llu\n", bufferBytesUsed);
+	statsFamily(&page, "rinetd_loop_iterations", "counter",
+		"Passes through the event loops of all workers");
+	statsPrint(&page, "rinetd_loop_iterations_total %llu\n", loopCount);
+	statsFamily(&page, "rinetd_syscalls", "counter",
+		"Input/output system calls");
+	statsPrint(&page, "rinetd_syscalls_total %llu\n", syscallCount);
+
+	/* How busy the event loops are */
+	static Histogram workTime;
+	unsigned long long watchedCount = 0, readyCount = 0;
+	unsigned long long callCount[callKinds] = { 0 };
+	unsigned long long blockedCount[callKinds] = { 0 };
+	memset(&histogram, 0, sizeof(histogram));
+	memset(&workTime, 0, sizeof(workTime));
+	for (int i = 0; i < woTotal; ++i) {
+		WorkerInfo const *info = &woInfo[i];
+		histogramMerge(&histogram, &info->waitTime);
+		histogramMerge(&workTime, &info->workTime);
+		watchedCount += info->watchedCount;
+		readyCount += info->readyCount;
+		for (int k = 0; k < callKinds; ++k) {
+			callCount[k] += info->callCount[k];
+			blockedCount[k] += info->blockedCount[k];
+		}
+	}
+	statsFamily(&page, "rinetd_loop_wait_seconds", "summary",
+		"Time each pass through an event loop spent waiting for events");
+	statsSummary(&page, "rinetd_loop_wait_seconds", "", &histogram);
+	statsFamily(&page, "rinetd_loop_work_seconds", "summary",
+		"Time each pass through an event loop spent handling events");
+	statsSummary(&page, "rinetd_loop_work_seconds", "", &workTime);
+	statsFamily(&page, "rinetd_loop_watched", "counter",
+		"Sockets, or io_uring operations, waited for by each pass");
+	statsPrint(&page, "rinetd_loop_watched_total %llu\n", watchedCount);
+	statsFamily(&page, "rinetd_loop_ready", "counter",
+		"Events returned to each pass");
+	statsPrint(&page, "rinetd_loop_ready_total %llu\n", readyCount);
+	static char const *const callNames[] = { "recv", "send", "accept" };
+	statsFamily(&page, "rinetd_calls", "counter",
+		"Receive, send and accept calls, or io_uring completions");
+	for (int k = 0; k < callKinds; ++k) {
+		statsPrint(&page, "rinetd_calls_total{call=\"%s\"} %llu\n",
+			callNames[k], callCount[k]);
+	}
+	statsFamily(&page, "rinetd_blocked_calls", "counter",
+		"Receive, send and accept calls that would have blocked");
+	for (int k = 0; k < callKinds; ++k) {
+		statsPrint(&page, "rinetd_blocked_calls_total{call=\"%s\"} %llu\n",
+			callNames[k], blockedCount[k]);
+	}
+	statsFamily(&page, "rinetd_stalls", "counter",
+		"Event loops found blocked by the watchdog, by what they were doing");
+	for (int p = 0; p < phaseKinds; ++p) {
+		unsigned long long stallCount = 0;
+		for (int i = 0; i < woTotal; ++i) {
+			stallCount += woInfo[i].stallCount[p];
+		}
+		statsPrint(&page, "rinetd_stalls_total{phase=\"%s\"} %llu\n",
+			watchdogPhaseName(p), stallCount);
+	}
+
+	statsFamily(&page, "rinetd_relayed_bytes", "counter",
+		"Bytes relayed in either direction");
+	statsPrint(&page, "rinetd_relayed_bytes_total %llu\n", relayedBytes);
+	statsFamily(&page, "rinetd_log_dropped_records", "counter",
+		"Access log records dropped because the log writer was late");
+	statsPrint(&page, "rinetd_log_dropped_records_total %llu\n",
+		logDroppedCount());
+	statsPrint(&page, "# EOF\n");
+	return page.length;
+}
+
+static void statsPrint(StatsPage *page, char const *format, ...)
+{
+	/* Keep counting once the buffer is full, so that the caller
+		knows how much room it takes */
+	int room = page->length < page->size ? page->size - page->length : 0;
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(room ? page->buffer + page->length : NULL,
+		room, format, args);
+	va_end(args);
+	if (length > 0) {
+		page->length += length;
+	}
+}
+
+static void statsFamily(StatsPage *page, char const *name,
+	char const *type, char const *help)
+{
+	statsPrint(page, "# TYPE %s %s\n# HELP %s %s.\n",
+		name, type, name, help);
+}
+
+static void statsSummary(StatsPage *page, char const *name,
+	char const *labels, Histogram const *histogram)
+{
+	for (size_t q = 0; q < sizeof(quantiles) / sizeof(*quantiles); ++q) {
+		statsPrint(page, "%s{%s%squantile=\"%g\"} %.6f\n",
+			name, labels, labels[0] ? "," : "", quantiles[q],
+			histogramQuantile(histogram, quantiles[q]) / 1e6);
+	}
+	if (labels[0]) {
+		statsPrint(page, "%s_sum{%s} %.6f\n%s_count{%s} %llu\n",
+			name, labels, histogram->sum / 1e6,
+			name, labels, histogram->count);
+	} else {
+		statsPrint(page, "%s_sum %.6f\n%s_count %llu\n",
+			name, histogram->sum / 1e6, name, histogram->count);
+	}
+}
+
+static unsigned long long statsServerSum(int server, size_t offset)
+{
+	/* Workers publish their counters once they have opened their
+		servers, and take them back before closing them, which only
+		happens during a reload. */
+	unsigned long long sum = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		ServerCounters const *counters = __atomic_load_n(
+			&woInfo[i].serverCounters, __ATOMIC_ACQUIRE);
+		if (counters && server < woInfo[i].serverCount) {
+			sum += *(unsigned long long const *)
+				((char const *)&counters[server] + offset);
+		}
+	}
+	return sum;
+}
+
+static void statsServerMerge(int server, size_t offset, Histogram *total)
+{
+	for (int i = 0; i < woTotal; ++i) {
+		ServerCounters const *counters = __atomic_load_n(
+			&woInfo[i].serverCounters, __ATOMIC_ACQUIRE);
+		if (counters && server < woInfo[i].serverCount) {
+			histogramMerge(total, (Histogram const *)
+				((char const *)&counters[server] + offset));
+		}
+	}
+}
+
+static unsigned long long statsBackendSum(int server, int backend,
+	size_t offset)
+{
+	unsigned long long sum = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		ServerCounters const *counters = __atomic_load_n(
+			&woInfo[i].serverCounters, __ATOMIC_ACQUIRE);
+		if (counters && server < woInfo[i].serverCount) {
+			sum += *(unsigned long long const *)
+				((char const *)&counters[server].backends[backend]
+					+ offset);
+		}
+	}
+	return sum;
+}
+
+/* Each worker has its own average, so give the mean of those that
+	connected to the backend at all */
+static long long statsBackendConnectTime(int server, int backend)
+{
+	long long sum = 0;
+	int count = 0;
+	for (int i = 0; i < woTotal; ++i) {
+		ServerCounters const *counters = __atomic_load_n(
+			&woInfo[i].serverCounters, __ATOMIC_ACQUIRE);
+		if (counters && server < woInfo[i].serverCount
+			&& counters[server].backends[backend].connectTime) {
+			sum += counters[server].backends[backend].connectTime;
+			++count;
+		}
+	}
+	return count ? sum / count : 0;
+}
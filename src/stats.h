@@ -0,0 +1,16 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Metrics page served by the stats listener. Workers keep counters
+	of their own, per server and globally, and the page adds them up,
+	so that a scrape costs the same whatever the number of
+	connections. */
+
+int statsFormat(char *buffer, int size);
@@ -0,0 +1,205 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdint.h>
+
+#include "net.h"
+#include "types.h"
+#include "timer.h"
+
+/* Four levels of 64 slots each cover about 194 days; later timers
+	wait in the last level until they get closer. A slot of level n
+	holds the timers expiring within one 64^n second block, and is
+	moved down one level when that block starts. */
+#define TIMER_BITS 6
+#define TIMER_SLOTS (1 << TIMER_BITS)
+#define TIMER_MASK (TIMER_SLOTS - 1)
+#define TIMER_LEVELS 4
+
+static THREAD_LOCAL struct {
+	/* Every timer expiring at or before this time has been run */
+	time_t now;
+	int count;
+	/* One bit per non-empty slot in each level */
+	uint64_t occupied[TIMER_LEVELS];
+	Timer *slots[TIMER_LEVELS * TIMER_SLOTS];
+} wheel;
+
+static void timerPlace(Timer *timer, time_t expires);
+static void timerUnlink(Timer *timer);
+static void timerCascade(int level, time_t t);
+
+void timerInit(Timer *timer, void (*handler)(Timer *), void *data)
+{
+	timer->next = NULL;
+	timer->prev = NULL;
+	timer->expires = 0;
+	timer->slot = -1;
+	timer->handler = handler;
+	timer->data = data;
+}
+
+/* Run the handler of the timer during the first timerRun() call made
+	after the given time. Setting a pending timer moves it. */
+void timerSet(Timer *timer, time_t expires)
+{
+	if (timer->prev) {
+		timerUnlink(timer);
+	} else {
+		if (!wheel.count) {
+			/* Nothing tracks the time while the wheel is empty */
+			wheel.now = time(NULL);
+		}
+		++wheel.count;
+	}
+	timer->expires = expires;
+	/* Overdue timers run on the next second */
+	timerPlace(timer, expires > wheel.now ? expires : wheel.now + 1);
+}
+
+void timerCancel(Timer *timer)
+{
+	if (timer->prev) {
+		timerUnlink(timer);
+		--wheel.count;
+	}
+}
+
+/* Return how many seconds the event loop may wait before calling
+	timerRun() again, or -1 if no timer is pending. Timers due within
+	a minute are waited for exactly; for later ones we wake up when
+	their slot is moved down a level, and then know better. */
+long timerNextExpiry(time_t now)
+{
+	if (!wheel.count) {
+		return -1;
+	}
+	time_t next = 0;
+	for (int level = 0; level < TIMER_LEVELS; ++level) {
+		uint64_t bits = wheel.occupied[level];
+		if (!bits) {
+			continue;
+		}
+		/* Slots are visited in order starting after the current one,
+			which comes back last, one full turn later. */
+		int shift = level * TIMER_BITS;
+		unsigned first = (unsigned)((wheel.now >> shift) + 1) & TIMER_MASK;
+		bits = first ? bits >> first | bits << (TIMER_SLOTS - first) : bits;
+#if defined __GNUC__
+		int distance = __builtin_ctzll(bits) + 1;
+#else
+		int distance = 1;
+		while (!(bits & 1)) {
+			bits >>= 1;
+			++distance;
+		}
+#endif
+		time_t t = ((wheel.now >> shift) + distance) << shift;
+		if (!next || t < next) {
+			next = t;
+		}
+	}
+	return next > now ? (long)(next - now) : 0;
+}
+
+/* Run the handlers of all timers that expired before the given time.
+	Handlers may set and cancel any timer, including their own. */
+void timerRun(time_t now)
+{
+	if (!wheel.count) {
+		wheel.now = now;
+		return;
+	}
+	while (wheel.now < now && wheel.count) {
+		time_t t = ++wheel.now;
+		/* Move timers down from all levels whose block starts now,
+			highest first so that they end in the right slot. */
+		int level = 0;
+		while (level + 1 < TIMER_LEVELS
+			&& !(t & (((time_t)1 << ((level + 1) * TIMER_BITS)) - 1))) {
+			++level;
+		}
+		for (; level > 0; --level) {
+			timerCascade(level, t);
+		}
+		/* Detach the slot first, so that handlers setting a timer
+			for one full turn later do not get run right away. */
+		int index = (int)(t & TIMER_MASK);
+		Timer *due = wheel.slots[index];
+		wheel.slots[index] = NULL;
+		wheel.occupied[0] &= ~((uint64_t)1 << index);
+		if (due) {
+			due->prev = &due;
+		}
+		while (due) {
+			Timer *timer = due;
+			timerUnlink(timer);
+			--wheel.count;
+			timer->handler(timer);
+		}
+	}
+	wheel.now = now;
+}
+
+static void timerPlace(Timer *timer, time_t expires)
+{
+	/* Timers moved down from a block that starts now may expire right
+		now, they are run after all moves are done. */
+	time_t delta = expires - wheel.now;
+	int level = 0;
+	while (level + 1 < TIMER_LEVELS
+		&& delta >= (time_t)1 << ((level + 1) * TIMER_BITS)) {
+		++level;
+	}
+	if (delta >= (time_t)1 << (TIMER_LEVELS * TIMER_BITS)) {
+		expires = wheel.now + ((time_t)1 << (TIMER_LEVELS * TIMER_BITS)) - 1;
+	}
+	int index = (int)(expires >> (level * TIMER_BITS)) & TIMER_MASK;
+	int slot = level * TIMER_SLOTS + index;
+
+	timer->slot = slot;
+	timer->prev = &wheel.slots[slot];
+	timer->next = wheel.slots[slot];
+	if (timer->next) {
+		timer->next->prev = &timer->next;
+	}
+	wheel.slots[slot] = timer;
+	wheel.occupied[level] |= (uint64_t)1 << index;
+}
+
+static void timerUnlink(Timer *timer)
+{
+	*timer->prev = timer->next;
+	if (timer->next) {
+		timer->next->prev = timer->prev;
+	}
+	if (!wheel.slots[timer->slot]) {
+		wheel.occupied[timer->slot / TIMER_SLOTS]
+			&= ~((uint64_t)1 << (timer->slot & TIMER_MASK));
+	}
+	timer->next = NULL;
+	timer->prev = NULL;
+	timer->slot = -1;
+}
+
+static void timerCascade(int level, time_t t)
+{
+	int index = (int)(t >> (level * TIMER_BITS)) & TIMER_MASK;
+	Timer *list = wheel.slots[level * TIMER_SLOTS + index];
+	wheel.slots[level * TIMER_SLOTS + index] = NULL;
+	wheel.occupied[level] &= ~((uint64_t)1 << index);
+	while (list) {
+		Timer *timer = list;
+		list = timer->next;
+		timerPlace(timer, timer->expires);
+	}
+}
@@ -0,0 +1,21 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Hierarchical timer wheel with a resolution of one second. Timers
+	are embedded in the objects they belong to; setting, cancelling
+	and expiring one is O(1) whatever the number of timers. Each
+	worker thread has its own wheel. */
+
+void timerInit(Timer *timer, void (*handler)(Timer *), void *data);
+void timerSet(Timer *timer, time_t expires);
+void timerCancel(Timer *timer);
+long timerNextExpiry(time_t now);
+void timerRun(time_t now);
+
@@ -10,6 +10,17 @@
 
 #include <time.h>
 
+/* Worker threads. Each worker has its own copy of the event loop
+	state, so most of it lives in thread-local variables. */
+
+#if HAVE_PTHREAD_H && defined SO_REUSEPORT
+#	include <pthread.h>
+#	define HAVE_WORKERS 1
+#	define THREAD_LOCAL __thread
+#else
+#	define THREAD_LOCAL
+#endif
+
 enum ruleType {
 	allowRule,
 	denyRule,
@@ -20,6 +31,19 @@ enum protocolType {
 	protoUdp = 2,
 };
 
+enum balanceType {
+	balanceRoundRobin = 1,
+	balanceLeastConnections = 2,
+	balancePowerOfTwo = 3,
+	balanceHash = 4,
+};
+
+enum engineType {
+	engineSelect = 1,
+	engineEpoll = 2,
+	engineUring = 3,
+};
+
 typedef struct _rule Rule;
 struct _rule
 {
@@ -27,25 +51,121 @@ struct _rule
 	int type;
 };
 
+/* Durations in microseconds, counted in 16 buckets for each power of
+	two, from one microsecond to about 19 hours, see histogram.h */
+enum { histogramBuckets = 528 };
+
+typedef struct _histogram Histogram;
+struct _histogram
+{
+	unsigned long long count, sum;
+	unsigned long long buckets[histogramBuckets];
+};
+
+typedef struct _backend Backend;
+struct _backend
+{
+	/* In network order, for network purposes */
+	struct in_addr addr;
+	unsigned short port;
+	/* In ASCII and local byte order, for logging purposes */
+	char *host;
+	int portNum;
+	/* Share of the connections, relative to the other backends */
+	int weight;
+	/* Set by the health checker, and read by every worker */
+	int down;
+	/* Written by every worker, see balanceFailed(): connections that
+		failed in a row, times the backend was ejected in a row, and
+		until when, before it gets traffic back gradually */
+	int failures, ejections;
+	time_t ejectedUntil;
+};
+
+/* Kept by each worker for each backend of its servers, see balance.c */
+typedef struct _backend_counters BackendCounters;
+struct _backend_counters
+{
+	unsigned long long connections, connects, connectFailures, ejections;
+	/* Moving average of the time to connect, in microseconds, and
+		when it was last updated */
+	long long connectTime;
+	time_t connectTimeUpdated;
+};
+
+/* Kept by each worker for each of its servers, see balance.c */
+typedef struct _balancer Balancer;
+
+/* Kept by each worker for each of its servers, see stats.c */
+typedef struct _server_counters ServerCounters;
+struct _server_counters
+{
+	unsigned long long connections;
+	unsigned long long accepts, udpSessions;
+	unsigned long long notAllowed, denied, connectFailures;
+	unsigned long long bytesIn, bytesOut;
+	/* Time from accepting a connection until the connection to the
+		local server is made, until its first byte is received, and
+		until the connection is over */
+	Histogram connectTime, firstByteTime, duration;
+	/* One for each backend of the server */
+	BackendCounters *backends;
+};
+
 typedef struct _server_info ServerInfo;
 struct _server_info {
 	SOCKET fd;
 
 	/* In network order, for network purposes */
-	struct in_addr localAddr;
-	unsigned short localPort;
+	struct in_addr bindAddr;
 	struct in_addr sourceAddr;
 
-	/* In ASCII and local byte order, for logging purposes */
+	/* In ASCII and local byte order, for logging purposes. The
+		forwarded-to address is the one of the first backend. */
 	char *fromHost, *toHost;
 	int fromPort, fromProto, toPort, toProto;
 
+	/* Where connections are forwarded to, and how one is chosen for
+		each connection, see balance.c. The schedule lists backends
+		as many times as their weight, interleaved. */
+	Backend *backends;
+	int backendCount, balance;
+	int *schedule, scheduleLength;
+	/* For the hash balancer, positions in the schedule by hash of
+		the client address, see balanceLookup() */
+	int *lookup;
+	/* Seconds between health checks of each backend, or 0 for none,
+		successes and failures in a row that change its state, and for
+		UDP, what to send and the start of the expected reply */
+	int checkInterval, checkRise, checkFall;
+	char *checkSend, *checkExpect;
+	/* Failures in a row that eject a backend, or 0 to never eject,
+		seconds of the first ejection, and seconds to wait for the
+		local server to accept, or 0 for as long as the system does */
+	int ejectFailures, ejectTime, connectTimeout;
+	/* Other backends tried when one fails before anything is relayed,
+		see retryConnection() */
+	int retries;
+
 	/* Offset and count into list of allow and deny rules. Any rules
 		prior to globalAllowRules and globalDenyRules are global rules. */
 	int rulesStart, rulesCount;
 	/* Timeout for UDP traffic before we consider the connection
 		was dropped by the remote host. */
 	int serverTimeout;
+	/* Maximum number of UDP datagrams received or sent with a single
+		system call */
+	int udpBatch;
+	/* Bounds of the buffer size of each direction, see sizeBuffer() */
+	int bufferMin, bufferMax;
+	/* Whether this serves the metrics page instead of forwarding */
+	int statsListener;
+	/* Only set in the copies of workers */
+	ServerCounters *counters;
+	Balancer *balancer;
+	/* Whether batched UDP replies wait for this socket to become
+		writable, see watchUdpWritable() */
+	int udpBlocked;
 };
 
 typedef struct _socket Socket;
@@ -54,10 +174,64 @@ struct _socket
 	SOCKET fd;
 	int proto;
 	/* recv: received on this socket
-		sent: sent to this socket from the other buffer */
+		sent: sent to this socket from the other buffer
+		Buffers are circular, so these wrap around modulo
+		RINETD_BUFFER_SIZE, see getRecvVectors(). */
 	int recvPos, sentPos;
-	int recvBytes, sentBytes;
+	unsigned long long recvBytes, sentBytes;
+	/* Only held while data is in flight, see getBuffer() */
 	char *buffer;
+	/* Size of the buffer, or of the next one taken. It is chosen from
+		the bytes received since sizedTime and the round-trip times. */
+	int bufferSize;
+	time_t sizedTime;
+	unsigned long long sizedBytes;
+	/* Events currently registered with the event engine, if any */
+	int interest;
+	/* Operations submitted to io_uring and not completed yet, and
+		the buffer lists they read to and write from */
+	int pending;
+	struct iovec recvVectors[2], sendVectors[2];
+	/* When splicing, data received on this socket goes through this
+		pipe instead of the buffer. The positions above still apply. */
+	int pipe[2];
+	/* Moving average of read sizes, to decide whether to splice */
+	int readSize;
+};
+
+typedef struct _timer Timer;
+struct _timer
+{
+	/* Neighbours in the wheel slot, see timer.c */
+	Timer *next, **prev;
+	time_t expires;
+	int slot;
+	void (*handler)(Timer *timer);
+	void *data;
+};
+
+/* Events kept by the flight recorder, see flight.h */
+enum {
+	flightAccept = 0,
+	flightConnectStart,
+	flightConnectDone,
+	flightRead,
+	flightWrite,
+	flightClose,
+};
+
+/* The first few events of each connection are kept, then only the
+	latest ones */
+enum { flightEvents = 16, flightFirstEvents = 4 };
+
+typedef struct _flight_event FlightEvent;
+struct _flight_event
+{
+	/* In microseconds since the connection was accepted */
+	long long time;
+	/* Bytes, or a negative error code */
+	int value;
+	unsigned char event, local;
 };
 
 typedef struct _connection_info ConnectionInfo;
@@ -66,9 +240,120 @@ struct _connection_info
 	Socket remote, local;
 	struct sockaddr_in remoteAddress;
 	time_t remoteTimeout;
+	/* When the connection was accepted, see logClock() */
+	long long openedTime;
+	/* Only used for UDP timeouts for now */
+	Timer timer;
 	int coClosing;
 	int coLog;
 	ServerInfo const *server; // only useful for logEvent
+	/* Position in the connection table, and next free connection
+		while this one is unused */
+	int index;
+	ConnectionInfo *nextFree;
+	/* Next UDP connection in the same hash bucket */
+	ConnectionInfo *udpNext;
+	/* Whether a reply to this connection is waiting to be sent with
+		other ones, see flushUdpReplies() */
+	int udpQueued;
+	/* Whether this is a request for the metrics page */
+	int coStats;
+	/* Whether a connection to the local server was started, and
+		whether it is still in progress, see handleConnect() */
+	int coForwarded, coConnecting;
+	/* Position of the chosen backend in the schedule of the server,
+		or -1 until one is chosen, see balancePick() */
+	int slot;
+	/* Backends tried after the first one, and whether the next one
+		waits for operations on the local socket to complete, see
+		retryConnection() */
+	int retries, coRetrying;
+	/* When the local server accepted the connection, see logClock(),
+		and whether it failed it, by not accepting it or hanging up
+		right after, which counts towards ejection */
+	long long connectedTime;
+	int coFailed;
+	/* Bounds of the buffer size, copied from the server because a
+		reload may close it while the connection lives on, see
+		sizeBuffer() */
+	int bufferMin, bufferMax;
+	/* Events of this connection, and whether it was slow enough to
+		have them logged once closed, see flight.h. The events take
+		256 bytes, so they are only allocated while the flight recorder
+		is on, with the connection segment, see addFlights(). */
+	FlightEvent *flight;
+	unsigned flightCount;
+	int coSlow;
+};
+
+typedef struct _log_record LogRecord;
+struct _log_record
+{
+	/* In microseconds since the epoch, see logClock() */
+	long long startTime, endTime;
+	/* Whether the address and byte counts are known */
+	int connection;
+	struct in_addr address;
+	unsigned long long bytesInput, bytesOutput;
+	/* Index in allServers, or -1 if unknown, and index of the
+		backend in the server, or -1 if none was chosen */
+	int server, backend;
+	int result;
+};
+
+/* System calls counted by kind, see countCall() */
+enum {
+	callRecv = 0,
+	callSend,
+	callAccept,
+	callKinds,
+};
+
+/* What an event loop is busy with, see watchdog.h */
+enum {
+	phaseRelay = 0,
+	phaseAccept,
+	phaseLog,
+	phaseReload,
+	phaseDns,
+	phaseKinds,
+};
+
+typedef struct _worker_info WorkerInfo;
+struct _worker_info
+{
+#if HAVE_WORKERS
+	pthread_t thread;
+#endif
+	/* Only written by the worker itself, and added up by
+		whoever wants the totals */
+	unsigned long long syscallCount, relayedBytes;
+	/* Bytes of connection buffers allocated, in use, and most ever
+		in use */
+	unsigned long long bufferBytes, bufferBytesUsed, bufferBytesHighWater;
+	/* Passes through the event loop, and connection slots allocated */
+	unsigned long long loopCount;
+	int connectionSlots;
+	/* Time of each pass spent waiting for events and handling them,
+		and sockets or operations waited for and ready, added up over
+		all passes, see loopWaited() */
+	Histogram waitTime, workTime;
+	unsigned long long watchedCount, readyCount;
+	/* Receive, send and accept calls, and those that would block */
+	unsigned long long callCount[callKinds], blockedCount[callKinds];
+	/* When the event loop stopped waiting, or 0 while it waits, and
+		what it has been busy with since. The watchdog sets stalled
+		to the phase plus one when it reports a stall. */
+	long long busySince;
+	int phase, stalled;
+	unsigned long long stallCount[phaseKinds];
+	/* Set to have the worker log the events of its connections */
+	int flightDumpRequested;
+	/* Counters of each server of this worker, see stats.c */
+	ServerCounters *serverCounters;
+	int serverCount;
+	/* Copies them to the statistics file, see segment.h */
+	Timer segmentTimer;
 };
 
 /* Option parsing */
@@ -78,5 +363,6 @@ struct _rinetd_options
 {
 	char const *conf_file;
 	int foreground;
+	int engine;
 };
 
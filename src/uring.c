@@ -0,0 +1,139 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <string.h>
+#include <sys/mman.h>
+
+#include "net.h"
+#include "types.h"
+#include "uring.h"
+
+#if HAVE_URING
+
+/* Each worker thread has its own ring */
+static THREAD_LOCAL struct {
+	int fd;
+	/* Submission queue; sqTail is our private copy of *sqKernelTail */
+	unsigned *sqHead, *sqKernelTail, *sqMask, *sqArray;
+	unsigned sqEntries, sqTail;
+	struct io_uring_sqe *sqes;
+	/* Completion queue */
+	unsigned *cqHead, *cqTail, *cqMask;
+	struct io_uring_cqe *cqes;
+} ring = { -1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+int uringInit(unsigned entries)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	/* We only ever submit from the thread that reaps completions */
+	p.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+	ring.fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (ring.fd < 0) {
+		/* Older kernels do not know about these flags */
+		memset(&p, 0, sizeof(p));
+		ring.fd = syscall(__NR_io_uring_setup, entries, &p);
+	}
+	if (ring.fd < 0) {
+		return -1;
+	}
+	if (!(p.features & IORING_FEAT_SINGLE_MMAP)
+		|| !(p.features & IORING_FEAT_NODROP)) {
+		close(ring.fd);
+		ring.fd = -1;
+		errno = ENOSYS;
+		return -1;
+	}
+
+	size_t sqSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	size_t cqSize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	size_t size = sqSize > cqSize ? sqSize : cqSize;
+	char *rings = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQ_RING);
+	struct io_uring_sqe *sqes = mmap(NULL,
+		p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring.fd, IORING_OFF_SQES);
+	if (rings == MAP_FAILED || sqes == MAP_FAILED) {
+		close(ring.fd);
+		ring.fd = -1;
+		return -1;
+	}
+
+	ring.sqHead = (unsigned *)(rings + p.sq_off.head);
+	ring.sqKernelTail = (unsigned *)(rings + p.sq_off.tail);
+	ring.sqMask = (unsigned *)(rings + p.sq_off.ring_mask);
+	ring.sqArray = (unsigned *)(rings + p.sq_off.array);
+	ring.sqEntries = p.sq_entries;
+	ring.sqTail = *ring.sqKernelTail;
+	ring.sqes = sqes;
+	ring.cqHead = (unsigned *)(rings + p.cq_off.head);
+	ring.cqTail = (unsigned *)(rings + p.cq_off.tail);
+	ring.cqMask = (unsigned *)(rings + p.cq_off.ring_mask);
+	ring.cqes = (struct io_uring_cqe *)(rings + p.cq_off.cqes);
+	return 0;
+}
+
+/* Return a cleared submission queue entry, or NULL if the queue is
+	full and uringEnter() needs to be called first. */
+struct io_uring_sqe *uringGetSqe(void)
+{
+	unsigned head = __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+	if (ring.sqTail - head >= ring.sqEntries) {
+		return NULL;
+	}
+	unsigned index = ring.sqTail & *ring.sqMask;
+	struct io_uring_sqe *sqe = &ring.sqes[index];
+	ring.sqArray[index] = index;
+	++ring.sqTail;
+	memset(sqe, 0, sizeof(*sqe));
+	return sqe;
+}
+
+/* Submit all queued entries with a single system call, and if wait is
+	set, block until at least one completion is available. Returns the
+	number of system calls made, or -1 on error. */
+int uringEnter(int wait)
+{
+	__atomic_store_n(ring.sqKernelTail, ring.sqTail, __ATOMIC_RELEASE);
+	unsigned toSubmit = ring.sqTail
+		- __atomic_load_n(ring.sqHead, __ATOMIC_ACQUIRE);
+	if (wait && *ring.cqHead != __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+		/* Completions are already waiting for us */
+		wait = 0;
+	}
+	if (!toSubmit && !wait) {
+		return 0;
+	}
+	if (syscall(__NR_io_uring_enter, ring.fd, toSubmit, wait ? 1 : 0,
+			wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0) < 0) {
+		return -1;
+	}
+	return 1;
+}
+
+/* Pop the next completion, if any. The entry is copied out so that
+	handling it may queue new submissions without further care. */
+int uringPeek(UringCompletion *cqe)
+{
+	unsigned head = *ring.cqHead;
+	if (head == __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE)) {
+		return 0;
+	}
+	struct io_uring_cqe const *entry = &ring.cqes[head & *ring.cqMask];
+	cqe->data = entry->user_data;
+	cqe->res = entry->res;
+	cqe->flags = entry->flags;
+	__atomic_store_n(ring.cqHead, head + 1, __ATOMIC_RELEASE);
+	return 1;
+}
+
+#endif /* HAVE_URING */
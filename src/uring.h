@@ -0,0 +1,38 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Minimal io_uring(7) support, using the raw system calls so that we
+	do not depend on liburing. Multishot accept appeared in Linux 5.19,
+	which is what we require. */
+
+#if HAVE_LINUX_IO_URING_H
+#	include <linux/io_uring.h>
+#	include <sys/syscall.h>
+#	if defined __NR_io_uring_setup && defined IORING_ACCEPT_MULTISHOT
+#		define HAVE_URING 1
+#	endif
+#endif
+
+#if HAVE_URING
+
+typedef struct _uring_completion UringCompletion;
+struct _uring_completion
+{
+	unsigned long long data;
+	int res;
+	unsigned flags;
+};
+
+int uringInit(unsigned entries);
+struct io_uring_sqe *uringGetSqe(void);
+int uringEnter(int wait);
+int uringPeek(UringCompletion *cqe);
+
+#endif /* HAVE_URING */
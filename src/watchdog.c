@@ -0,0 +1,122 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#if HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "net.h"
+#include "types.h"
+#include "rinetd.h"
+#include "log.h"
+#include "watchdog.h"
+
+static char const *const phaseNames[] = {
+	"relaying",
+	"accepting",
+	"logging",
+	"reloading",
+	"resolving",
+};
+
+#if HAVE_WORKERS
+static int watchdogStarted = 0;
+static void *watchdogThread(void *arg);
+#endif
+
+/* Microseconds from an arbitrary point, unaffected by clock changes */
+long long watchdogClock(void)
+{
+#if HAVE_CLOCK_GETTIME
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+#else
+	return logClock();
+#endif
+}
+
+/* Called once the workers are started, and after each reload since
+	the watchdog may have just been configured */
+void watchdogStart(void)
+{
+	if (!watchdogThreshold) {
+		return;
+	}
+#if HAVE_WORKERS
+	if (watchdogStarted) {
+		return;
+	}
+	pthread_t thread;
+	int ret = pthread_create(&thread, NULL, watchdogThread, NULL);
+	if (ret != 0) {
+		errno = ret;
+		syslog(LOG_ERR, "could not start the watchdog (%m)\n");
+		return;
+	}
+	pthread_detach(thread);
+	watchdogStarted = 1;
+#else
+	syslog(LOG_ERR, "the watchdog is not supported on this system\n");
+#endif
+}
+
+char const *watchdogPhaseName(int phase)
+{
+	return phaseNames[phase];
+}
+
+#if HAVE_WORKERS
+static void *watchdogThread(void *arg)
+{
+	(void)arg;
+	/* The number of workers only changes with a restart */
+	long long *reported = (long long *)calloc(woTotal, sizeof(long long));
+	if (!reported) {
+		return NULL;
+	}
+	while (1) {
+		int threshold = __atomic_load_n(&watchdogThreshold, __ATOMIC_RELAXED);
+		/* Check often enough to notice a stall soon after it starts,
+			and keep sleeping while the watchdog is turned off */
+		long delay = threshold ? threshold * 250L : 1000000L;
+		struct timespec ts;
+		ts.tv_sec = delay / 1000000;
+		ts.tv_nsec = delay % 1000000 * 1000;
+		nanosleep(&ts, NULL);
+		if (!threshold) {
+			continue;
+		}
+
+		long long now = watchdogClock();
+		for (int i = 0; i < woTotal; ++i) {
+			WorkerInfo *info = &woInfo[i];
+			long long since = __atomic_load_n(&info->busySince,
+				__ATOMIC_RELAXED);
+			if (!since || since == reported[i]
+				|| now - since < threshold * 1000LL) {
+				continue;
+			}
+			reported[i] = since;
+			int phase = __atomic_load_n(&info->phase, __ATOMIC_RELAXED);
+			__atomic_fetch_add(&info->stallCount[phase], 1,
+				__ATOMIC_RELAXED);
+			__atomic_store_n(&info->stalled, phase + 1, __ATOMIC_RELAXED);
+			syslog(LOG_ERR, "worker %d: event loop blocked for more than "
+				"%d ms while %s\n", i, threshold, phaseNames[phase]);
+		}
+	}
+	return NULL;
+}
+#endif
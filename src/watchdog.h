@@ -0,0 +1,18 @@
+/* Copyright © 1997—1999 Thomas Boutell <boutell@boutell.com>
+                         and Boutell.Com, Inc.
+             © 2003—2017 Sam Hocevar <sam@hocevar.net>
+
+   This software is released for free use under the terms of
+   the GNU Public License, version 2 or higher. NO WARRANTY
+   IS EXPRESSED OR IMPLIED. USE THIS SOFTWARE AT YOUR OWN RISK. */
+
+#pragma once
+
+/* Stall watchdog. Workers note when their event loop stops waiting
+	for events and what it is busy with, and a thread of its own checks
+	a few times per threshold that none has been busy for longer. Each
+	stall is logged once, and counted against the phase that caused it. */
+
+long long watchdogClock(void);
+void watchdogStart(void);
+char const *watchdogPhaseName(int phase);